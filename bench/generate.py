@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+# -*- Python -*-
+#
+# Generates synthetic translation units for the benchmarks. Each generator
+# scales one dimension, which the analysis is sensitive to.
+
+import argparse
+import sys
+
+
+def functions(size):
+    """ Many free functions with a few locals each. """
+    result = []
+    for index in range(size):
+        result.append(
+            'int function_{0}(int a, int& b) {{\n'
+            '    int x = a + {0};\n'
+            '    int y = x * 2;\n'
+            '    b += y;\n'
+            '    return x;\n'
+            '}}\n'.format(index))
+    return ''.join(result)
+
+
+def locals(size):
+    """ One function with many local variables. """
+    result = ['int locals(int seed) {\n', '    int sum = 0;\n']
+    for index in range(size):
+        result.append('    int local_{0} = seed + {0};\n'.format(index))
+        if index % 2:
+            result.append('    sum += local_{0};\n'.format(index))
+    result.append('    return sum;\n}\n')
+    return ''.join(result)
+
+
+def members(size):
+    """ One class with many member variables and a few methods. """
+    result = ['struct Members {\n']
+    for index in range(size):
+        result.append('    int member_{0};\n'.format(index))
+    result.append('    int get() { return member_0; }\n')
+    result.append('    void set(int v) {{ member_{0} = v; }}\n'.format(size - 1))
+    result.append('    int sum() {\n        int result = 0;\n')
+    for index in range(size):
+        result.append('        result += member_{0};\n'.format(index))
+    result.append('        return result;\n    }\n};\n')
+    return ''.join(result)
+
+
+def methods(size):
+    """ One class with many methods, which are calling each other. """
+    result = ['struct Methods {\n', '    int value;\n', '    int other;\n']
+    for index in range(size):
+        if index % 3 == 0:
+            body = 'value += {0};'.format(index)
+        elif index % 3 == 1:
+            body = 'method_{0}(); other = value;'.format(index - 1)
+        else:
+            body = 'int local = other + {0}; (void)local;'.format(index)
+        result.append('    void method_{0}() {{ {1} }}\n'.format(index, body))
+    result.append('};\n')
+    return ''.join(result)
+
+
+def inheritance(size):
+    """ A linear class hierarchy. """
+    result = ['struct Base_0 {\n    int member_0;\n    void touch_0() { member_0 = 0; }\n};\n']
+    for index in range(1, size):
+        result.append(
+            'struct Base_{0} : Base_{1} {{\n'
+            '    int member_{0};\n'
+            '    int read_{0}() {{ return member_{0} + member_{1}; }}\n'
+            '}};\n'.format(index, index - 1))
+    return ''.join(result)
+
+
+def diamonds(size):
+    """ A class hierarchy of stacked (virtual) diamonds, with the methods on
+    the most derived class. """
+    result = ['struct Diamond_0 {\n    int member_0;\n};\n']
+    for index in range(1, size):
+        result.append(
+            'struct Left_{0} : virtual Diamond_{1} {{ int left_{0}; }};\n'
+            'struct Right_{0} : virtual Diamond_{1} {{ int right_{0}; }};\n'
+            'struct Diamond_{0} : Left_{0}, Right_{0} {{ int member_{0}; }};\n'
+            .format(index, index - 1))
+    result.append(
+        'struct Bottom : Diamond_{0} {{\n'
+        '    int read() {{ return member_0 + member_{0} + left_{0} + right_{0}; }}\n'
+        '    void touch() {{ member_0 = 0; }}\n'
+        '}};\n'.format(size - 1))
+    return ''.join(result)
+
+
+def nesting(size):
+    """ Deeply nested expressions with member accesses and calls. """
+    result = [
+        'struct Node {\n'
+        '    int value;\n'
+        '    Node* next;\n'
+        '    int get() const { return value; }\n'
+        '};\n'
+        'int nesting(Node& node, int seed) {\n'
+        '    int result = ']
+    result.append('(' * size)
+    result.append('seed')
+    for index in range(size):
+        result.append(' + node.next->get()) * {0}'.format(index % 7 + 1)
+                      if index % 2 else
+                      ' + node.value)')
+    result.append(';\n    return result;\n}\n')
+    return ''.join(result)
+
+
+def aliases(size):
+    """ Long chains of references, which refer to each other. """
+    result = ['int aliases(int seed) {\n', '    int alias_0 = seed;\n']
+    for index in range(1, size):
+        result.append('    int& alias_{0} = alias_{1};\n'.format(index, index - 1))
+    result.append('    ++alias_{0};\n'.format(size - 1))
+    result.append('    return alias_0;\n}\n')
+    return ''.join(result)
+
+
+def member_aliases(size):
+    """ A long chain of references in a method, which starts at a member. """
+    result = ['struct Aliases {\n', '    int member;\n', '    int aliases(int seed) {\n',
+              '        int& alias_0 = member;\n']
+    for index in range(1, size):
+        result.append('        int& alias_{0} = alias_{1};\n'.format(index, index - 1))
+    result.append('        alias_{0} += seed;\n'.format(size - 1))
+    result.append('        return alias_0;\n    }\n};\n')
+    return ''.join(result)
+
+
+def chains(size):
+    """ A long chain of member accesses through this. """
+    return (
+        'struct Chain {{\n'
+        '    int value;\n'
+        '    Chain* next;\n'
+        '    int chain() const {{ return this{0}->value; }}\n'
+        '}};\n'.format('->next' * size))
+
+
+def arguments(size):
+    """ Deeply nested call arguments, which pass a reference through. """
+    result = [
+        'int& pass(int& value, int step) {\n'
+        '    value += step;\n'
+        '    return value;\n'
+        '}\n'
+        'int arguments(int seed) {\n'
+        '    int x = seed;\n'
+        '    return ']
+    result.append('pass(' * size)
+    result.append('x')
+    for index in range(size):
+        result.append(', {0})'.format(index))
+    result.append(';\n}\n')
+    return ''.join(result)
+
+
+def precompiled_header(size):
+    """ A header with many classes, to put into a precompiled header. """
+    result = []
+    for index in range(size):
+        result.append(
+            'struct Header_{0} {{\n'
+            '    int member_{0};\n'
+            '    int get() const {{ return member_{0}; }}\n'
+            '    void set(int v) {{ int x = v; member_{0} = x; }}\n'
+            '}};\n'
+            'inline int header_{0}(Header_{0}& h) {{ int y = h.get(); h.set(y); return y; }}\n'
+            .format(index))
+    return ''.join(result)
+
+
+def precompiled_source(size):
+    """ A small translation unit, which uses the precompiled header. """
+    return (
+        'int precompiled(int seed) {{\n'
+        '    Header_{0} h = {{ seed }};\n'
+        '    int x = header_{0}(h);\n'
+        '    return x + h.get();\n'
+        '}}\n'.format(size - 1))
+
+
+GENERATORS = {
+    'functions': functions,
+    'locals': locals,
+    'members': members,
+    'methods': methods,
+    'inheritance': inheritance,
+    'diamonds': diamonds,
+    'nesting': nesting,
+    'aliases': aliases,
+    'member_aliases': member_aliases,
+    'chains': chains,
+    'arguments': arguments,
+}
+
+
+def generate(dimension, size):
+    """ Returns the source code of a translation unit. """
+    return '// generated: {0} {1}\n{2}'.format(
+        dimension, size, GENERATORS[dimension](size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('dimension', choices=sorted(GENERATORS.keys()))
+    parser.add_argument('size', type=int)
+    parser.add_argument('-o', '--output', default='-')
+    args = parser.parse_args()
+
+    source = generate(args.dimension, args.size)
+    if args.output == '-':
+        sys.stdout.write(source)
+    else:
+        with open(args.output, 'w') as handle:
+            handle.write(source)
+
+
+if __name__ == '__main__':
+    main()
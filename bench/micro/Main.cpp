@@ -0,0 +1,295 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libconstantine_a/DeclarationCollector.hpp"
+#include "libconstantine_a/ModuleAnalysis.hpp"
+#include "libconstantine_a/ScopeAnalysis.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace {
+
+    llvm::cl::OptionCategory Category("constantine-micro options");
+
+    llvm::cl::opt<unsigned> Repetitions(
+            "repetitions",
+            llvm::cl::desc("Number of samples per benchmark"),
+            llvm::cl::init(15),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<unsigned> SampleTime(
+            "sample-ms",
+            llvm::cl::desc("Minimum duration of a sample (in milliseconds)"),
+            llvm::cl::init(20),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<std::string> Output(
+            "o",
+            llvm::cl::desc("Output file of the results (JSON)"),
+            llvm::cl::init("-"),
+            llvm::cl::cat(Category));
+
+    llvm::cl::list<std::string> Benchmarks(
+            "benchmark",
+            llvm::cl::desc("Run only these benchmarks (scope-analysis, member-variables, referred-variables, module-analysis)"),
+            llvm::cl::CommaSeparated,
+            llvm::cl::cat(Category));
+
+    llvm::cl::list<std::string> ExtraArgs(
+            "extra-arg",
+            llvm::cl::desc("Additional argument to the compiler"),
+            llvm::cl::cat(Category));
+
+    llvm::cl::list<std::string> Sources(
+            llvm::cl::Positional,
+            llvm::cl::desc("<source file> ..."),
+            llvm::cl::OneOrMore,
+            llvm::cl::cat(Category));
+
+
+    // The results of the measured calls are added to this, so the calls
+    // are not optimised away.
+    std::size_t volatile Sink = 0;
+
+    // Collects the inputs of the benchmarks from the main file: the
+    // functions with body (not templates), the methods and the local
+    // variables of those. The declarations and statements of the main
+    // file are counted, that is the unit of the results.
+    class Prepared : public clang::RecursiveASTVisitor<Prepared> {
+    public:
+        explicit Prepared(clang::SourceManager const & SM)
+            : clang::RecursiveASTVisitor<Prepared>()
+            , Sources(SM)
+            , Nodes(0)
+            , Functions()
+            , Methods()
+            , Locals()
+        { }
+
+        Prepared(Prepared const &) = delete;
+        Prepared & operator=(Prepared const &) = delete;
+
+        bool VisitDecl(clang::Decl const * const D) {
+            if (IsMain(D->getLocation()))
+                ++Nodes;
+            return true;
+        }
+
+        bool VisitStmt(clang::Stmt const * const S) {
+            if (IsMain(S->getBeginLoc()))
+                ++Nodes;
+            return true;
+        }
+
+        bool VisitFunctionDecl(clang::FunctionDecl const * const F) {
+            if (IsMain(F->getLocation()) && F->doesThisDeclarationHaveABody() && (! F->isTemplated())) {
+                Functions.push_back(F);
+                if (auto const M = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+                    Methods.push_back(M);
+                }
+                Variables const Declared = GetVariablesFromContext(F);
+                Locals.insert(Locals.end(), Declared.begin(), Declared.end());
+            }
+            return true;
+        }
+
+    private:
+        bool IsMain(clang::SourceLocation const Location) const {
+            return Location.isValid() && Sources.isInMainFile(Sources.getExpansionLoc(Location));
+        }
+
+    public:
+        clang::SourceManager const & Sources;
+        std::size_t Nodes;
+        std::vector<clang::FunctionDecl const *> Functions;
+        std::vector<clang::CXXMethodDecl const *> Methods;
+        std::vector<clang::DeclaratorDecl const *> Locals;
+    };
+
+
+    // Time of one call per node, in nanoseconds.
+    struct Statistics {
+        unsigned Iterations;
+        double Median;
+        double Mean;
+        double Deviation;
+        double Minimum;
+    };
+
+    // A sample repeats the call until the minimum sample time is reached
+    // (the number of the repetitions is calibrated before, that is the
+    // warm up too), and gives the time of one call.
+    Statistics Measure(llvm::function_ref<void()> const Function, std::size_t const Nodes) {
+        typedef std::chrono::steady_clock Clock;
+        auto const RunSample = [Function](unsigned const Iterations) {
+            auto const Start = Clock::now();
+            for (unsigned It = 0; It < Iterations; ++It) {
+                Function();
+            }
+            return Clock::now() - Start;
+        };
+        unsigned Iterations = 1;
+        while ((RunSample(Iterations) < std::chrono::milliseconds(SampleTime)) && (Iterations < (1u << 20))) {
+            Iterations *= 2;
+        }
+        std::vector<double> Samples;
+        for (unsigned Sample = 0; Sample < std::max(1u, unsigned(Repetitions)); ++Sample) {
+            double const Elapsed = std::chrono::duration<double, std::nano>(RunSample(Iterations)).count();
+            Samples.push_back(Elapsed / Iterations / std::max<std::size_t>(Nodes, 1));
+        }
+        std::sort(Samples.begin(), Samples.end());
+        std::size_t const Half = Samples.size() / 2;
+        double const Median = (Samples.size() % 2) ? Samples[Half] : ((Samples[Half - 1] + Samples[Half]) / 2);
+        double const Mean = std::accumulate(Samples.begin(), Samples.end(), 0.0) / Samples.size();
+        double Squares = 0;
+        for (auto const Sample : Samples) {
+            Squares += (Sample - Mean) * (Sample - Mean);
+        }
+        double const Deviation = (Samples.size() > 1) ? std::sqrt(Squares / (Samples.size() - 1)) : 0.0;
+        return Statistics { Iterations, Median, Mean, Deviation, Samples.front() };
+    }
+
+    bool IsSelected(llvm::StringRef const Name) {
+        return Benchmarks.empty() || llvm::any_of(Benchmarks, [Name](std::string const & Benchmark) { return Name == Benchmark; });
+    }
+
+    void WriteBenchmark(llvm::json::OStream & J, llvm::StringRef const Name, std::size_t const Calls, Statistics const & Result) {
+        J.attributeObject(Name, [&]() {
+            J.attribute("calls", static_cast<int64_t>(Calls));
+            J.attribute("iterations", Result.Iterations);
+            J.attributeObject("ns_per_node", [&]() {
+                J.attribute("median", Result.Median);
+                J.attribute("mean", Result.Mean);
+                J.attribute("stddev", Result.Deviation);
+                J.attribute("min", Result.Minimum);
+            });
+        });
+    }
+
+    // The AST is built once (from memory), then the analysis steps are
+    // measured on it: the scope analysis of the function bodies, the
+    // member variables of the methods, the referred variables of the
+    // locals, and the whole module analysis (with the report).
+    bool RunBenchmarks(std::string const & Source, llvm::json::OStream & J) {
+        auto const Content = llvm::MemoryBuffer::getFile(Source);
+        if (! Content) {
+            llvm::errs() << "constantine-micro: cannot read " << Source << ": " << Content.getError().message() << '\n';
+            return false;
+        }
+        std::vector<std::string> Args = { "-std=c++14" };
+        Args.insert(Args.end(), ExtraArgs.begin(), ExtraArgs.end());
+        // The findings are reported to the diagnostics, those are not
+        // printed. (The consumer shall live as long as the AST.)
+        static clang::IgnoringDiagConsumer Ignore;
+        std::unique_ptr<clang::ASTUnit> const AST = clang::tooling::buildASTFromCodeWithArgs(
+            (*Content)->getBuffer(), Args, Source, "constantine-micro",
+            std::make_shared<clang::PCHContainerOperations>(),
+            clang::tooling::getClangStripDependencyFileAdjuster(),
+            clang::tooling::FileContentMappings(), &Ignore);
+        if ((! AST) || AST->getDiagnostics().hasErrorOccurred()) {
+            llvm::errs() << "constantine-micro: cannot parse " << Source << '\n';
+            return false;
+        }
+        clang::ASTContext & Ctx = AST->getASTContext();
+        Prepared Inputs(Ctx.getSourceManager());
+        Inputs.TraverseDecl(Ctx.getTranslationUnitDecl());
+
+        J.object([&]() {
+            J.attribute("input", Source);
+            J.attribute("nodes", static_cast<int64_t>(Inputs.Nodes));
+            J.attributeObject("benchmarks", [&]() {
+                if (IsSelected("scope-analysis")) {
+                    WriteBenchmark(J, "scope-analysis", Inputs.Functions.size(), Measure([&Inputs]() {
+                        for (auto && F : Inputs.Functions) {
+                            Sink += ScopeAnalysis::AnalyseThis(*(F->getBody())).WasThisReferenced() ? 1 : 0;
+                        }
+                    }, Inputs.Nodes));
+                }
+                if (IsSelected("member-variables")) {
+                    WriteBenchmark(J, "member-variables", Inputs.Methods.size(), Measure([&Inputs]() {
+                        for (auto && M : Inputs.Methods) {
+                            Sink += GetMemberVariablesAndReferences(M->getParent(), M).size();
+                        }
+                    }, Inputs.Nodes));
+                }
+                if (IsSelected("referred-variables")) {
+                    WriteBenchmark(J, "referred-variables", Inputs.Locals.size(), Measure([&Inputs]() {
+                        for (auto && V : Inputs.Locals) {
+                            Sink += GetReferredVariables(V).size();
+                        }
+                    }, Inputs.Nodes));
+                }
+                if (IsSelected("module-analysis")) {
+                    WriteBenchmark(J, "module-analysis", 1, Measure([&AST, &Ctx]() {
+                        ModuleAnalysis Analysis(AST->getDiagnostics(), ModuleAnalysisOptions());
+                        Analysis.HandleTranslationUnit(Ctx);
+                    }, Inputs.Nodes));
+                }
+            });
+        });
+        return true;
+    }
+}
+
+
+// Measures the steps of the analysis in process, on ASTs which were built
+// once, so the parsing is not part of the measurement. The results are
+// nanoseconds per AST node (of the main file) per call.
+int main(int argc, char const *argv[]) {
+    llvm::cl::HideUnrelatedOptions(Category);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Microbenchmarks of the constantine analysis.\n");
+
+    std::error_code Error;
+    llvm::raw_fd_ostream Stream(Output, Error, llvm::sys::fs::OF_Text);
+    if (Error) {
+        llvm::errs() << "constantine-micro: cannot open " << Output << ": " << Error.message() << '\n';
+        return 1;
+    }
+
+    unsigned Failures = 0;
+    {
+        llvm::json::OStream J(Stream, 2);
+        J.array([&]() {
+            for (auto && Source : Sources) {
+                if (! RunBenchmarks(Source, J))
+                    ++Failures;
+            }
+        });
+    }
+    Stream << '\n';
+    return (0 == Failures) ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+# -*- Python -*-
+#
+# Runs the compiler on the generated translation units with and without
+# the plugin, and reports the plugin's added wall time and peak memory as
+# JSON.
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+import generate
+
+
+DEFAULT_SIZES = {
+    'functions': [250, 500, 1000, 2000],
+    'locals': [250, 500, 1000, 2000],
+    'members': [100, 200, 400, 800],
+    'methods': [100, 200, 400, 800],
+    'inheritance': [25, 50, 100, 200],
+    'diamonds': [4, 8, 12, 16],
+    'nesting': [50, 100, 200, 400],
+    'aliases': [50, 100, 200, 400],
+    'chains': [50, 100, 200, 400],
+    'arguments': [50, 100, 200, 400],
+    'precompiled': [500, 1000, 2000, 4000],
+}
+
+
+def measure(command):
+    """ Run the command, returns the wall time (seconds) and the peak
+    resident set size (kilobytes) of it. """
+    with open(os.devnull, 'w') as devnull:
+        start = time.perf_counter()
+        process = subprocess.Popen(command, stdout=devnull, stderr=devnull)
+        _, status, usage = os.wait4(process.pid, 0)
+        elapsed = time.perf_counter() - start
+        process.returncode = os.waitstatus_to_exitcode(status) \
+            if hasattr(os, 'waitstatus_to_exitcode') else status
+    if process.returncode != 0:
+        raise RuntimeError('command failed: {0}'.format(' '.join(command)))
+    return elapsed, usage.ru_maxrss
+
+
+def summarize(samples):
+    """ Median of the samples, it is less sensitive to noise. """
+    return {
+        'wall_seconds': statistics.median(sample[0] for sample in samples),
+        'max_rss_kb': statistics.median(sample[1] for sample in samples),
+    }
+
+
+def compile_command(args, source, with_plugin, extra=()):
+    # the nesting dimensions go deeper than the default bracket depth
+    command = [args.clang, '-fsyntax-only', '-std=c++14', '-fbracket-depth=1024'] + list(extra) + [source]
+    if with_plugin:
+        for flag in ['-load', args.plugin, '-add-plugin', 'constantine']:
+            command.extend(['-Xclang', flag])
+        for flag in args.plugin_arg:
+            command.extend(['-Xclang', '-plugin-arg-constantine', '-Xclang', flag])
+    return command
+
+
+def compare(args, dimension, size, source, extra=()):
+    baseline = [measure(compile_command(args, source, False, extra)) for _ in range(args.repeat)]
+    plugin = [measure(compile_command(args, source, True, extra)) for _ in range(args.repeat)]
+    result = {
+        'dimension': dimension,
+        'size': size,
+        'baseline': summarize(baseline),
+        'plugin': summarize(plugin),
+    }
+    result['added_wall_seconds'] = \
+        result['plugin']['wall_seconds'] - result['baseline']['wall_seconds']
+    result['added_max_rss_kb'] = \
+        result['plugin']['max_rss_kb'] - result['baseline']['max_rss_kb']
+    return result
+
+
+def run_precompiled(args, size):
+    """ The translation unit is small, the precompiled header is big. The
+    plugin shall not load the declarations of the precompiled header. """
+    header = os.path.join(args.work_dir, 'precompiled_{0}.hpp'.format(size))
+    with open(header, 'w') as handle:
+        handle.write(generate.precompiled_header(size))
+    pch = header + '.pch'
+    subprocess.check_call([args.clang, '-x', 'c++-header', '-std=c++14', header, '-o', pch])
+
+    source = os.path.join(args.work_dir, 'precompiled_{0}.cpp'.format(size))
+    with open(source, 'w') as handle:
+        handle.write(generate.precompiled_source(size))
+    return compare(args, 'precompiled', size, source, ['-include-pch', pch])
+
+
+def run(args, dimension, size):
+    if dimension == 'precompiled':
+        return run_precompiled(args, size)
+
+    source = os.path.join(args.work_dir, '{0}_{1}.cpp'.format(dimension, size))
+    with open(source, 'w') as handle:
+        handle.write(generate.generate(dimension, size))
+    return compare(args, dimension, size, source)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--clang', required=True)
+    parser.add_argument('--plugin', required=True)
+    parser.add_argument('--plugin-arg', action='append', default=[])
+    parser.add_argument('--work-dir', required=True)
+    parser.add_argument('--output', default='-')
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--dimension', action='append', default=[],
+                        choices=sorted(DEFAULT_SIZES.keys()))
+    args = parser.parse_args()
+
+    os.makedirs(args.work_dir, exist_ok=True)
+    dimensions = args.dimension if args.dimension else sorted(DEFAULT_SIZES.keys())
+    results = []
+    for dimension in dimensions:
+        for size in DEFAULT_SIZES[dimension]:
+            results.append(run(args, dimension, size))
+            sys.stderr.write('{0} {1}: +{2:.3f}s\n'.format(
+                dimension, size, results[-1]['added_wall_seconds']))
+
+    report = json.dumps({
+        'clang': args.clang,
+        'plugin': args.plugin,
+        'plugin_args': args.plugin_arg,
+        'repeat': args.repeat,
+        'results': results,
+    }, indent=2, sort_keys=True)
+    if args.output == '-':
+        sys.stdout.write(report + '\n')
+    else:
+        with open(args.output, 'w') as handle:
+            handle.write(report + '\n')
+
+
+if __name__ == '__main__':
+    main()
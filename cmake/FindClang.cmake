@@ -3,6 +3,8 @@
 #   CLANG_INCLUDE_DIRS
 #   CLANG_DEFINITIONS
 #   CLANG_EXECUTABLE
+#   CLANG_LIBRARIES (empty when the shared libraries are not installed)
+#   CLANG_RESOURCE_DIR
 
 function(set_clang_definitions config_cmd)
   execute_process(
@@ -56,6 +58,54 @@ function(set_clang_include_dirs config_cmd)
   set(CLANG_INCLUDE_DIRS ${include_dirs} PARENT_SCOPE)
 endfunction()
 
+function(set_clang_libraries config_cmd)
+  execute_process(
+    COMMAND ${config_cmd} --libdir
+    OUTPUT_VARIABLE llvm_lib_dir
+    OUTPUT_STRIP_TRAILING_WHITESPACE)
+  find_library(CLANG_CPP_LIBRARY
+    NAMES clang-cpp
+    PATHS ${llvm_lib_dir}
+    NO_DEFAULT_PATH)
+  find_library(LLVM_LIBRARY
+    NAMES LLVM
+    PATHS ${llvm_lib_dir}
+    NO_DEFAULT_PATH)
+  if(CLANG_CPP_LIBRARY AND LLVM_LIBRARY)
+    set(CLANG_LIBRARIES ${CLANG_CPP_LIBRARY} ${LLVM_LIBRARY} PARENT_SCOPE)
+  else()
+    set(CLANG_LIBRARIES "" PARENT_SCOPE)
+  endif()
+endfunction()
+
+# the builtin headers of the linked libraries (not of the clang executable),
+# older releases name the directory by the full, newer by the major version
+function(set_clang_resource_dir config_cmd)
+  execute_process(
+    COMMAND ${config_cmd} --libdir
+    OUTPUT_VARIABLE llvm_lib_dir
+    OUTPUT_STRIP_TRAILING_WHITESPACE)
+  execute_process(
+    COMMAND ${config_cmd} --version
+    OUTPUT_VARIABLE llvm_version
+    OUTPUT_STRIP_TRAILING_WHITESPACE)
+  string(REGEX MATCH "^[0-9]+(\\.[0-9]+)*" llvm_version ${llvm_version})
+  string(REGEX MATCH "^[0-9]+" llvm_major_version ${llvm_version})
+
+  set(resource_dir "${llvm_lib_dir}/clang/${llvm_version}")
+  foreach(version ${llvm_version} ${llvm_major_version})
+    if(IS_DIRECTORY "${llvm_lib_dir}/clang/${version}/include")
+      set(resource_dir "${llvm_lib_dir}/clang/${version}")
+      break()
+    endif()
+  endforeach()
+  if(NOT IS_DIRECTORY "${resource_dir}/include")
+    message(WARNING "Can't find the builtin headers of Clang: ${resource_dir}")
+  endif()
+
+  set(CLANG_RESOURCE_DIR ${resource_dir} PARENT_SCOPE)
+endfunction()
+
 
 find_program(LLVM_CONFIG
   NAMES llvm-config-12 llvm-config-11 llvm-config-10 llvm-config-9 llvm-config-8 llvm-config llvm-config-64
@@ -77,8 +127,12 @@ endif()
 
 set_clang_definitions(${LLVM_CONFIG})
 set_clang_include_dirs(${LLVM_CONFIG})
+set_clang_libraries(${LLVM_CONFIG})
+set_clang_resource_dir(${LLVM_CONFIG})
 
 message(STATUS "llvm-config filtered cpp flags : ${CLANG_DEFINITIONS}")
 message(STATUS "llvm-config filtered include dirs : ${CLANG_INCLUDE_DIRS}")
+message(STATUS "clang libraries : ${CLANG_LIBRARIES}")
+message(STATUS "clang resource dir : ${CLANG_RESOURCE_DIR}")
 
 set(CLANG_FOUND 1)
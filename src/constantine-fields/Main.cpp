@@ -0,0 +1,232 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libconstantine_a/FieldFacts.hpp"
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace {
+
+    llvm::cl::OptionCategory Category("constantine-fields options");
+
+    llvm::cl::opt<std::string> Database(
+            "database",
+            llvm::cl::desc("Database file to update (it is created when missing)"),
+            llvm::cl::init(""),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<std::string> Output(
+            "o",
+            llvm::cl::desc("Output file of the member variable findings"),
+            llvm::cl::init("-"),
+            llvm::cl::cat(Category));
+
+    llvm::cl::list<std::string> Inputs(
+            llvm::cl::Positional,
+            llvm::cl::desc("<fact file or directory> ..."),
+            llvm::cl::OneOrMore,
+            llvm::cl::cat(Category));
+
+
+    // The directories are expanded to the fact files in those. The paths
+    // are absolute, because the database refers to the fact files by
+    // their path.
+    bool CollectFiles(std::vector<std::string> & Result) {
+        for (auto && Input : Inputs) {
+            std::vector<std::string> Files;
+            if (! llvm::sys::fs::is_directory(Input)) {
+                Files.push_back(Input);
+            } else {
+                std::error_code Error;
+                for (llvm::sys::fs::directory_iterator It(Input, Error), End; (It != End) && (! Error); It.increment(Error)) {
+                    if (llvm::sys::path::extension(It->path()) == ".fields")
+                        Files.push_back(It->path());
+                }
+                if (Error) {
+                    llvm::errs() << "constantine-fields: cannot read " << Input << ": " << Error.message() << '\n';
+                    return false;
+                }
+            }
+            for (auto && File : Files) {
+                llvm::SmallString<256> Path(File);
+                llvm::sys::fs::make_absolute(Path);
+                Result.push_back(Path.str().str());
+            }
+        }
+        std::sort(Result.begin(), Result.end());
+        Result.erase(std::unique(Result.begin(), Result.end()), Result.end());
+        return true;
+    }
+
+    // A broken database is not fatal, it is rebuilt from the fact files.
+    void LoadDatabase(FieldDatabase & Result) {
+        if (Database.empty() || (! llvm::sys::fs::exists(Database)))
+            return;
+
+        auto const Buffer = llvm::MemoryBuffer::getFile(Database, -1, false);
+        if ((! Buffer) || (! Result.Read((*Buffer)->getBuffer()))) {
+            llvm::errs() << "constantine-fields: cannot read " << Database << ", it is rebuilt\n";
+        }
+    }
+
+    // The database is replaced atomically, a concurrent reader sees either
+    // the old or the new one.
+    bool StoreDatabase(FieldDatabase const & Source) {
+        llvm::SmallString<256> Temporary;
+        int FD = -1;
+        if (std::error_code const Error = llvm::sys::fs::createUniqueFile(Database + "-%%%%%%%%.tmp", FD, Temporary)) {
+            llvm::errs() << "constantine-fields: cannot write " << Database << ": " << Error.message() << '\n';
+            return false;
+        }
+        {
+            llvm::raw_fd_ostream Stream(FD, true);
+            Source.Write(Stream);
+            Stream.close();
+            if (Stream.has_error()) {
+                Stream.clear_error();
+                llvm::sys::fs::remove(Temporary);
+                llvm::errs() << "constantine-fields: cannot write " << Database << '\n';
+                return false;
+            }
+        }
+        if (std::error_code const Error = llvm::sys::fs::rename(Temporary, Database)) {
+            llvm::sys::fs::remove(Temporary);
+            llvm::errs() << "constantine-fields: cannot write " << Database << ": " << Error.message() << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    struct Verdict {
+        std::string Name;
+        std::string Location;
+    };
+
+    // The locations are "file:line:column", those are ordered by the file
+    // name, then by the line and column numbers.
+    std::tuple<llvm::StringRef, unsigned, unsigned> GetOrder(llvm::StringRef const Location) {
+        auto const Column = Location.rsplit(':');
+        auto const Line = Column.first.rsplit(':');
+        unsigned LineNumber = 0;
+        unsigned ColumnNumber = 0;
+        Line.second.getAsInteger(10, LineNumber);
+        Column.second.getAsInteger(10, ColumnNumber);
+        return std::make_tuple(Line.first, LineNumber, ColumnNumber);
+    }
+}
+
+
+// Merges the member variable facts of the translation units into a whole
+// program verdict: a member variable is reported when no translation unit
+// changes it. With a database, only the fact files which were changed
+// since the last run are read, the facts of the others are taken from the
+// database. (The fact files which were not given are dropped.)
+int main(int argc, char const *argv[]) {
+    llvm::cl::HideUnrelatedOptions(Category);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Merges the member variable facts of constantine.\n");
+
+    std::vector<std::string> Files;
+    if (! CollectFiles(Files))
+        return 1;
+
+    FieldDatabase Facts;
+    LoadDatabase(Facts);
+
+    unsigned Read = 0;
+    unsigned Unchanged = 0;
+    unsigned Removed = 0;
+    unsigned Failures = 0;
+    llvm::StringSet<> Present;
+    for (auto && File : Files) {
+        Present.insert(File);
+        llvm::sys::fs::file_status Status;
+        if (std::error_code const Error = llvm::sys::fs::status(File, Status)) {
+            llvm::errs() << "constantine-fields: cannot read " << File << ": " << Error.message() << '\n';
+            Facts.Remove(File);
+            ++Failures;
+            continue;
+        }
+        FieldDatabase::Stamp const When = {
+            Status.getSize(),
+            static_cast<uint64_t>(Status.getLastModificationTime().time_since_epoch().count())
+        };
+        if (Facts.IsCurrent(File, When)) {
+            ++Unchanged;
+            continue;
+        }
+        // The fact file is memory mapped (when it is big enough), the
+        // facts are read in place.
+        auto const Buffer = llvm::MemoryBuffer::getFile(File, -1, false);
+        if (! Buffer) {
+            llvm::errs() << "constantine-fields: cannot read " << File << ": " << Buffer.getError().message() << '\n';
+            Facts.Remove(File);
+            ++Failures;
+            continue;
+        }
+        if (! Facts.Update(File, When, (*Buffer)->getBuffer())) {
+            llvm::errs() << "constantine-fields: cannot parse " << File << '\n';
+            ++Failures;
+            continue;
+        }
+        ++Read;
+    }
+    for (auto && Source : Facts.GetSources()) {
+        if (0 == Present.count(Source)) {
+            Facts.Remove(Source);
+            ++Removed;
+        }
+    }
+    if ((! Database.empty()) && (! StoreDatabase(Facts)))
+        ++Failures;
+
+    std::vector<Verdict> Verdicts;
+    Facts.ForEachConst([&Verdicts](FieldFact const & Fact) {
+        Verdicts.push_back(Verdict { Fact.Name.str(), Fact.Location.str() });
+    });
+    std::sort(Verdicts.begin(), Verdicts.end(), [](Verdict const & Lhs, Verdict const & Rhs) {
+        return std::make_tuple(GetOrder(Lhs.Location), Lhs.Name) < std::make_tuple(GetOrder(Rhs.Location), Rhs.Name);
+    });
+
+    std::error_code Error;
+    llvm::raw_fd_ostream Stream(Output, Error, llvm::sys::fs::OF_Text);
+    if (Error) {
+        llvm::errs() << "constantine-fields: cannot open " << Output << ": " << Error.message() << '\n';
+        return 1;
+    }
+    for (auto && Found : Verdicts) {
+        Stream << Found.Location << ": warning: variable '" << Found.Name << "' could be declared as const\n";
+    }
+
+    llvm::errs() << "constantine-fields: " << Read << " fact files read, " << Unchanged << " unchanged, "
+                 << Removed << " removed, " << Verdicts.size() << " member variables could be const\n";
+    return (0 == Failures) ? 0 : 1;
+}
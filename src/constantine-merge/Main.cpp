@@ -0,0 +1,176 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libconstantine_a/FieldFacts.hpp"
+#include "libconstantine_a/Replacements.hpp"
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace {
+
+    llvm::cl::OptionCategory Category("constantine-merge options");
+
+    llvm::cl::opt<std::string> Output(
+            "o",
+            llvm::cl::desc("Output file of the merged replacements"),
+            llvm::cl::init("-"),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<std::string> Fields(
+            "fields",
+            llvm::cl::desc("Database of constantine-fields, to keep the edits of the member variables which no translation unit changes"),
+            llvm::cl::init(""),
+            llvm::cl::cat(Category));
+
+    llvm::cl::list<std::string> Inputs(
+            llvm::cl::Positional,
+            llvm::cl::desc("<replacements file or directory> ..."),
+            llvm::cl::OneOrMore,
+            llvm::cl::cat(Category));
+
+
+    // The directories are expanded to the YAML files in those, in name
+    // order, to have the same output on every run.
+    bool CollectFiles(std::vector<std::string> & Result) {
+        for (auto && Input : Inputs) {
+            if (! llvm::sys::fs::is_directory(Input)) {
+                Result.push_back(Input);
+                continue;
+            }
+            std::vector<std::string> Files;
+            std::error_code Error;
+            for (llvm::sys::fs::directory_iterator It(Input, Error), End; (It != End) && (! Error); It.increment(Error)) {
+                if (llvm::sys::path::extension(It->path()) == ".yaml")
+                    Files.push_back(It->path());
+            }
+            if (Error) {
+                llvm::errs() << "constantine-merge: cannot read " << Input << ": " << Error.message() << '\n';
+                return false;
+            }
+            std::sort(Files.begin(), Files.end());
+            Result.insert(Result.end(), Files.begin(), Files.end());
+        }
+        return true;
+    }
+
+    // The member variables which can be const, by the whole program
+    // verdict of the database.
+    bool LoadConstFields(llvm::StringSet<> & Result) {
+        auto const Buffer = llvm::MemoryBuffer::getFile(Fields, -1, false);
+        FieldDatabase Facts;
+        if ((! Buffer) || (! Facts.Read((*Buffer)->getBuffer()))) {
+            llvm::errs() << "constantine-merge: cannot read " << Fields << '\n';
+            return false;
+        }
+        Facts.ForEachConst([&Result](FieldFact const & Fact) {
+            Result.insert(Fact.USR);
+        });
+        return true;
+    }
+
+    // A translation unit reports a member variable, when its functions do
+    // not change it. But the functions of an other translation unit might
+    // do, when the class is declared in a header. The edits of those are
+    // kept with the whole program verdict only.
+    bool IsValid(Replacement const & R, llvm::StringRef const MainSourceFile, llvm::StringSet<> const * const ConstFields) {
+        if (R.Field.empty())
+            return true;
+        if (ConstFields)
+            return ConstFields->count(R.Field);
+        return R.FilePath == MainSourceFile;
+    }
+
+    std::string GetKey(Replacement const & R) {
+        return R.FilePath + '\0' + std::to_string(R.Offset) + '\0' + std::to_string(R.Length) + '\0' + R.Text;
+    }
+}
+
+
+// Merges the replacements files of the translation units into one. The
+// same header is edited by many translation units, those edits are
+// written once. The input files are read one by one, only the keys of the
+// written replacements are kept in memory. (Conflicting edits are left
+// to clang-apply-replacements to report.) The edits of the member
+// variables are checked against the database of constantine-fields, or
+// kept only in the main file of their translation unit without it.
+int main(int argc, char const *argv[]) {
+    llvm::cl::HideUnrelatedOptions(Category);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Merges the replacements of constantine.\n");
+
+    std::vector<std::string> Files;
+    if (! CollectFiles(Files))
+        return 1;
+
+    std::error_code Error;
+    llvm::raw_fd_ostream Stream(Output, Error, llvm::sys::fs::OF_Text);
+    if (Error) {
+        llvm::errs() << "constantine-merge: cannot open " << Output << ": " << Error.message() << '\n';
+        return 1;
+    }
+
+    llvm::StringSet<> ConstFields;
+    if ((! Fields.empty()) && (! LoadConstFields(ConstFields)))
+        return 1;
+
+    llvm::StringSet<> Written;
+    unsigned Duplicates = 0;
+    unsigned Dropped = 0;
+    unsigned Failures = 0;
+    WriteReplacementsBegin(Stream, llvm::StringRef());
+    for (auto && File : Files) {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> const Buffer = llvm::MemoryBuffer::getFile(File);
+        if (! Buffer) {
+            llvm::errs() << "constantine-merge: cannot read " << File << ": " << Buffer.getError().message() << '\n';
+            ++Failures;
+            continue;
+        }
+        std::string MainSourceFile;
+        bool const Parsed = ReadReplacements((*Buffer)->getBuffer(), MainSourceFile, [&](Replacement const & R) {
+            if (! IsValid(R, MainSourceFile, (Fields.empty()) ? nullptr : &ConstFields)) {
+                ++Dropped;
+            } else if (Written.insert(GetKey(R)).second) {
+                WriteReplacement(Stream, R);
+            } else {
+                ++Duplicates;
+            }
+        });
+        if (! Parsed) {
+            llvm::errs() << "constantine-merge: cannot parse " << File << '\n';
+            ++Failures;
+        }
+    }
+    WriteReplacementsEnd(Stream);
+
+    llvm::errs() << "constantine-merge: " << Written.size() << " replacements written, "
+                 << Duplicates << " duplicates removed, "
+                 << Dropped << " member variable edits dropped\n";
+    return (0 == Failures) ? 0 : 1;
+}
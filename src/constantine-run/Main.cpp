@@ -0,0 +1,312 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libconstantine_a/ModuleAnalysis.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <clang/Basic/DiagnosticOptions.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Frontend/TextDiagnosticPrinter.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Regex.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace {
+
+    llvm::cl::OptionCategory Category("constantine-run options");
+
+    llvm::cl::opt<std::string> BuildPath(
+            "p",
+            llvm::cl::desc("Directory which contains the compile_commands.json file"),
+            llvm::cl::init("."),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<unsigned> Jobs(
+            "j",
+            llvm::cl::desc("Number of worker threads (0 means one per core)"),
+            llvm::cl::init(0),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<std::string> Filter(
+            "filter",
+            llvm::cl::desc("Analyse only those files which match this regular expression"),
+            llvm::cl::init(".*"),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<bool> AnalyseHeaders(
+            "analyze-headers",
+            llvm::cl::desc("Report findings from user headers too"),
+            llvm::cl::init(false),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<bool> AnalyseInstantiations(
+            "analyze-instantiations",
+            llvm::cl::desc("Analyse the templates through their instantiations"),
+            llvm::cl::init(false),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<bool> SummariseParameters(
+            "parameter-summaries",
+            llvm::cl::desc("Evaluate the calls by the parameter changes of the callee"),
+            llvm::cl::init(false),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<unsigned> AnalysisJobs(
+            "analysis-jobs",
+            llvm::cl::desc("Number of threads to analyse the functions of one file"),
+            llvm::cl::init(1),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<bool> Streaming(
+            "streaming",
+            llvm::cl::desc("Analyse the functions as those are parsed"),
+            llvm::cl::init(false),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<MemoryReport> Memory(
+            "memory-report",
+            llvm::cl::desc("Report the heap allocations of the analysis"),
+            llvm::cl::values(
+                clEnumValN(MemoryReport::None, "none", "No report"),
+                clEnumValN(MemoryReport::Stderr, "stderr", "One line per translation unit to the standard error"),
+                clEnumValN(MemoryReport::Json, "json", "JSON file per translation unit into the findings directory")),
+            llvm::cl::init(MemoryReport::None),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<std::string> CacheDirectory(
+            "cache-dir",
+            llvm::cl::desc("Directory to cache the header findings"),
+            llvm::cl::init(""),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<OutputFormat> Format(
+            "findings-format",
+            llvm::cl::desc("Output format of the findings"),
+            llvm::cl::values(
+                clEnumValN(OutputFormat::Diagnostics, "diagnostics", "Compiler warnings"),
+                clEnumValN(OutputFormat::JsonLines, "jsonl", "JSON Lines file per translation unit"),
+                clEnumValN(OutputFormat::Sarif, "sarif", "SARIF file per translation unit"),
+                clEnumValN(OutputFormat::Replacements, "replacements", "clang-apply-replacements file per translation unit")),
+            llvm::cl::init(OutputFormat::Diagnostics),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<std::string> OutputDirectory(
+            "findings-dir",
+            llvm::cl::desc("Directory of the findings files"),
+            llvm::cl::init("."),
+            llvm::cl::cat(Category));
+
+    llvm::cl::opt<bool> FieldFacts(
+            "field-facts",
+            llvm::cl::desc("Write the member variable facts for the whole program merge"),
+            llvm::cl::init(false),
+            llvm::cl::cat(Category));
+
+    llvm::cl::list<std::string> Sources(
+            llvm::cl::Positional,
+            llvm::cl::desc("[<source> ...]"),
+            llvm::cl::cat(Category));
+
+
+    // Runs the same analysis as the plugin does, but without code generation.
+    class AnalysisAction : public clang::ASTFrontendAction {
+    public:
+        explicit AnalysisAction(ModuleAnalysisOptions const &Options)
+        : clang::ASTFrontendAction()
+        , Options(Options)
+        {}
+
+        AnalysisAction(AnalysisAction const &) = delete;
+
+        AnalysisAction &operator=(AnalysisAction const &) = delete;
+
+    private:
+        std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance &C, llvm::StringRef) override {
+            return C.getLangOpts().CPlusPlus
+                   ? std::unique_ptr<clang::ASTConsumer>(new ModuleAnalysis(C, Options))
+                   : std::make_unique<clang::ASTConsumer>();
+        }
+
+    private:
+        ModuleAnalysisOptions const &Options;
+    };
+
+    class AnalysisActionFactory : public clang::tooling::FrontendActionFactory {
+    public:
+        explicit AnalysisActionFactory(ModuleAnalysisOptions const &Options)
+        : clang::tooling::FrontendActionFactory()
+        , Options(Options)
+        {}
+
+        std::unique_ptr<clang::FrontendAction> create() override {
+            return std::make_unique<AnalysisAction>(Options);
+        }
+
+    private:
+        ModuleAnalysisOptions const &Options;
+    };
+
+
+    // The result of a single translation unit analysis.
+    struct Outcome {
+        std::string Diagnostics;
+        bool Failed;
+    };
+
+    // Analyse one translation unit. The diagnostics are buffered, and
+    // printed by the caller, to not mix the output of parallel runs.
+    Outcome Analyse(clang::tooling::CompilationDatabase const &Database,
+                    ModuleAnalysisOptions const &Options,
+                    std::string const &File) {
+        Outcome Result = { std::string(), false };
+        llvm::raw_string_ostream Stream(Result.Diagnostics);
+
+        llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts = new clang::DiagnosticOptions();
+        clang::TextDiagnosticPrinter Printer(Stream, &*DiagOpts);
+
+        // Each thread needs its own file system, because the working
+        // directory of the compilations might be different.
+        llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FileSystem =
+                llvm::vfs::createPhysicalFileSystem().release();
+        clang::tooling::ClangTool Tool(Database, { File },
+                std::make_shared<clang::PCHContainerOperations>(), FileSystem);
+        // The builtin headers shall come from the same Clang, which
+        // the analysis was linked against.
+        Tool.appendArgumentsAdjuster(clang::tooling::getInsertArgumentAdjuster(
+                "-resource-dir=" CLANG_RESOURCE_DIR,
+                clang::tooling::ArgumentInsertPosition::END));
+        Tool.setDiagnosticConsumer(&Printer);
+
+        AnalysisActionFactory Factory(Options);
+        Result.Failed = (0 != Tool.run(&Factory));
+
+        Stream.flush();
+        return Result;
+    }
+
+    // The files of the compilation database in the order of the entries.
+    // (The 'getAllFiles' method does not keep that order.) The names are
+    // absolute, the same way as the database looks up the commands.
+    std::vector<std::string> GetFilesInOrder(clang::tooling::CompilationDatabase const &Database) {
+        std::vector<std::string> Result;
+        llvm::StringSet<> Seen;
+        for (auto &&Command : Database.getAllCompileCommands()) {
+            llvm::SmallString<256> Path;
+            if (llvm::sys::path::is_relative(Command.Filename)) {
+                Path = Command.Directory;
+                llvm::sys::path::append(Path, Command.Filename);
+                llvm::sys::path::remove_dots(Path, true);
+            } else {
+                Path = Command.Filename;
+            }
+            llvm::sys::path::native(Path);
+            if (Seen.insert(Path).second) {
+                Result.push_back(Path.str().str());
+            }
+        }
+        return Result;
+    }
+
+    // Select the files to analyse. Files given on the command line shall
+    // be in the compilation database too.
+    std::vector<std::string> SelectFiles(clang::tooling::CompilationDatabase const &Database) {
+        std::vector<std::string> const Candidates = Sources.empty()
+                ? GetFilesInOrder(Database)
+                : std::vector<std::string>(Sources.begin(), Sources.end());
+
+        llvm::Regex Pattern(Filter);
+        std::vector<std::string> Result;
+        for (auto &&File : Candidates) {
+            if (Pattern.match(File)) {
+                Result.push_back(File);
+            }
+        }
+        return Result;
+    }
+
+} // namespace anonymous
+
+int main(int argc, char const *argv[]) {
+    llvm::cl::HideUnrelatedOptions(Category);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Runs pseudo const analysis on a compilation database.\n");
+
+    std::string Error;
+    std::unique_ptr<clang::tooling::CompilationDatabase> const Database =
+            clang::tooling::CompilationDatabase::loadFromDirectory(BuildPath, Error);
+    if (! Database) {
+        llvm::errs() << "constantine-run: " << Error << '\n';
+        return 1;
+    }
+
+    std::string RegexError;
+    if (! llvm::Regex(Filter).isValid(RegexError)) {
+        llvm::errs() << "constantine-run: invalid filter: " << RegexError << '\n';
+        return 1;
+    }
+
+    ModuleAnalysisOptions Options;
+    Options.AnalyseHeaders = AnalyseHeaders;
+    Options.AnalyseInstantiations = AnalyseInstantiations;
+    Options.SummariseParameters = SummariseParameters;
+    Options.Jobs = AnalysisJobs;
+    Options.Streaming = Streaming;
+    Options.Memory = Memory;
+    Options.CacheDirectory = CacheDirectory;
+    Options.Format = Format;
+    Options.OutputDirectory = OutputDirectory;
+    Options.FieldFacts = FieldFacts;
+
+    std::vector<std::string> const Files = SelectFiles(*Database);
+    std::vector<Outcome> Outcomes(Files.size());
+    {
+        llvm::ThreadPool Pool(llvm::hardware_concurrency(Jobs));
+        for (size_t Index = 0; Index < Files.size(); ++Index) {
+            Pool.async([&Database, &Options, &Files, &Outcomes](size_t const Current) {
+                Outcomes[Current] = Analyse(*Database, Options, Files[Current]);
+            }, Index);
+        }
+        Pool.wait();
+    }
+
+    // Merge the findings in the order of the compilation database (or of
+    // the command line), to get the same output regardless of the scheduling.
+    unsigned Failures = 0;
+    for (size_t Index = 0; Index < Files.size(); ++Index) {
+        llvm::outs() << Outcomes[Index].Diagnostics;
+        if (Outcomes[Index].Failed) {
+            llvm::errs() << "constantine-run: failed to analyse " << Files[Index] << '\n';
+            ++Failures;
+        }
+    }
+    return (0 == Failures) ? 0 : 1;
+}
@@ -21,6 +21,7 @@
 
 #include <memory>
 
+#include <llvm/Support/CommandLine.h>
 #include <clang/Frontend/FrontendPluginRegistry.h>
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/AST/ASTConsumer.h>
@@ -28,10 +29,15 @@
 
 namespace {
 
+    char const * const plugin_name = "constantine";
+
     // The const analyser plugin...
     class Plugin : public clang::PluginASTAction {
     public:
-        Plugin() : clang::PluginASTAction() {}
+        Plugin()
+        : clang::PluginASTAction()
+        , Options()
+        {}
 
         Plugin(Plugin const &) = delete;
 
@@ -47,18 +53,93 @@ namespace {
         // ..:: Entry point for plugins ::..
         std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance &C, llvm::StringRef) override {
             return IsCPlusPlus(C)
-                   ? std::unique_ptr<clang::ASTConsumer>(new ModuleAnalysis(C))
+                   ? std::unique_ptr<clang::ASTConsumer>(new ModuleAnalysis(C, Options))
                    : std::make_unique<clang::ASTConsumer>();
         }
 
         // ..:: Entry point for plugins ::..
         bool ParseArgs(clang::CompilerInstance const &,
                        std::vector<std::string> const &Args) override {
+            std::vector<char const *> ArgPtrs;
+            {
+                // make llvm::cl::ParseCommandLineOptions happy
+                ArgPtrs.push_back(plugin_name);
+                for (auto && Arg : Args) {
+                    ArgPtrs.push_back(Arg.c_str());
+                }
+            }
+            {
+                static llvm::cl::opt<bool> const
+                    AnalyseHeaders("analyze-headers",
+                        llvm::cl::desc("Report findings from user headers too"),
+                        llvm::cl::init(false));
+                static llvm::cl::opt<bool> const
+                    AnalyseInstantiations("analyze-instantiations",
+                        llvm::cl::desc("Analyse the templates through their instantiations"),
+                        llvm::cl::init(false));
+                static llvm::cl::opt<bool> const
+                    SummariseParameters("parameter-summaries",
+                        llvm::cl::desc("Evaluate the calls by the parameter changes of the callee"),
+                        llvm::cl::init(false));
+                static llvm::cl::opt<unsigned> const
+                    Jobs("analysis-jobs",
+                        llvm::cl::desc("Number of threads to analyse the functions"),
+                        llvm::cl::init(1));
+                static llvm::cl::opt<bool> const
+                    Streaming("streaming",
+                        llvm::cl::desc("Analyse the functions as those are parsed"),
+                        llvm::cl::init(false));
+                static llvm::cl::opt<MemoryReport> const
+                    Memory("memory-report",
+                        llvm::cl::desc("Report the heap allocations of the analysis"),
+                        llvm::cl::values(
+                            clEnumValN(MemoryReport::None, "none", "No report"),
+                            clEnumValN(MemoryReport::Stderr, "stderr", "One line per translation unit to the standard error"),
+                            clEnumValN(MemoryReport::Json, "json", "JSON file per translation unit into the findings directory")),
+                        llvm::cl::init(MemoryReport::None));
+                static llvm::cl::opt<std::string> const
+                    CacheDirectory("cache-dir",
+                        llvm::cl::desc("Directory to cache the header findings"),
+                        llvm::cl::init(""));
+                static llvm::cl::opt<OutputFormat> const
+                    Format("findings-format",
+                        llvm::cl::desc("Output format of the findings"),
+                        llvm::cl::values(
+                            clEnumValN(OutputFormat::Diagnostics, "diagnostics", "Compiler warnings"),
+                            clEnumValN(OutputFormat::JsonLines, "jsonl", "JSON Lines file per translation unit"),
+                            clEnumValN(OutputFormat::Sarif, "sarif", "SARIF file per translation unit"),
+                            clEnumValN(OutputFormat::Replacements, "replacements", "clang-apply-replacements file per translation unit")),
+                        llvm::cl::init(OutputFormat::Diagnostics));
+                static llvm::cl::opt<std::string> const
+                    OutputDirectory("findings-dir",
+                        llvm::cl::desc("Directory of the findings files"),
+                        llvm::cl::init("."));
+                static llvm::cl::opt<bool> const
+                    FieldFacts("field-facts",
+                        llvm::cl::desc("Write the member variable facts for the whole program merge"),
+                        llvm::cl::init(false));
+
+                llvm::cl::ParseCommandLineOptions(ArgPtrs.size(), &ArgPtrs.front());
+
+                Options.AnalyseHeaders = AnalyseHeaders;
+                Options.AnalyseInstantiations = AnalyseInstantiations;
+                Options.SummariseParameters = SummariseParameters;
+                Options.Jobs = Jobs;
+                Options.Streaming = Streaming;
+                Options.Memory = Memory;
+                Options.CacheDirectory = CacheDirectory;
+                Options.Format = Format;
+                Options.OutputDirectory = OutputDirectory;
+                Options.FieldFacts = FieldFacts;
+            }
             return true;
         }
+
+    private:
+        ModuleAnalysisOptions Options;
     };
 
 } // namespace anonymous
 
 static clang::FrontendPluginRegistry::Add<Plugin>
-        Register("constantine", "suggest const usage");
+        Register(plugin_name, "suggest const usage");
@@ -19,28 +19,11 @@
 
 #include "DeclarationCollector.hpp"
 
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
 
-namespace {
-
-std::set<clang::CXXRecordDecl const *> AllBase(clang::CXXRecordDecl const * Decl) {
-    std::set<clang::CXXRecordDecl const *> Result;
-
-    llvm::SmallVector<clang::CXXRecordDecl const *, 8> Queue;
-    Queue.push_back(Decl);
 
-    while (! Queue.empty()) {
-        auto const Current = Queue.pop_back_val();
-        for (const auto & BaseIt : Current->bases()) {
-            if (auto const * Record = BaseIt.getType()->getAs<clang::RecordType>()) {
-                if (auto const * Base = clang::cast_or_null<clang::CXXRecordDecl>(Record->getDecl()->getDefinition())) {
-                    Queue.push_back(Base);
-                }
-            }
-        }
-        Result.insert(Current);
-    }
-    return Result;
-}
+namespace {
 
 // Strip away parentheses and casts we don't care about.
 clang::Expr const * StripExpr(clang::Expr const * E) {
@@ -70,15 +53,14 @@ clang::Expr const * StripExpr(clang::Expr const * E) {
     return E;
 }
 
-std::set<clang::Expr const *> CollectRefereeExpr(clang::Expr const * const E) {
-    std::set<clang::Expr const *> Result;
+FlatSet<clang::Expr const *> CollectRefereeExpr(clang::Expr const * const E) {
+    FlatSet<clang::Expr const *> Result;
 
-    std::set<clang::Expr const *> Works;
-    Works.insert(E);
+    llvm::SmallVector<clang::Expr const *, 4> Works;
+    Works.push_back(E);
 
     while (! Works.empty()) {
-        auto const Current = *(Works.begin());
-        Works.erase(Works.begin());
+        auto const Current = Works.pop_back_val();
 
         if (decltype(Current) const Stripped = StripExpr(Current)) {
             if (clang::dyn_cast<clang::DeclRefExpr const>(Stripped)) {
@@ -94,8 +76,8 @@ std::set<clang::Expr const *> CollectRefereeExpr(clang::Expr const * const E) {
                 }
                 Result.insert(ME);
             } else if (auto const ACO = clang::dyn_cast<clang::AbstractConditionalOperator const>(Stripped)) {
-                Works.insert(ACO->getTrueExpr());
-                Works.insert(ACO->getFalseExpr());
+                Works.push_back(ACO->getTrueExpr());
+                Works.push_back(ACO->getFalseExpr());
             }
         }
     }
@@ -118,51 +100,91 @@ clang::DeclaratorDecl const * GetDeclarationFromExpr(clang::Expr const * const E
 
 
 Variables GetVariablesFromContext(clang::DeclContext const * const F, bool const WithoutArgs) {
-    Variables Result;
+    llvm::SmallVector<clang::DeclaratorDecl const *, 16> Result;
     for (auto const & It : F->decls()) {
         if (auto const D = clang::dyn_cast<clang::VarDecl const>(It)) {
             if (! (WithoutArgs && (clang::dyn_cast<clang::ParmVarDecl const>(D)))) {
-                Result.insert(D);
+                Result.push_back(D);
             }
         }
     }
-    return Result;
+    return Variables(Result.begin(), Result.end());
 }
 
 Variables GetVariablesFromRecord(clang::CXXRecordDecl const * const Record) {
-    Variables Result;
-    for (auto const & RecordIt : AllBase(Record)) {
-        for (const auto & FieldIt : RecordIt->fields()) {
-            Result.insert(FieldIt);
-        }
-    }
-    return Result;
+    RecordSummaryCache Cache;
+    return Cache.Get(Record).MemberVariables;
 }
 
 Methods GetMethodsFromRecord(clang::CXXRecordDecl const * const Record) {
-    Methods Result;
-    for (auto const & RecordIt : AllBase(Record)) {
-        for (auto const & MethodIt : RecordIt->methods()) {
-            Result.insert(MethodIt->getCanonicalDecl());
+    RecordSummaryCache Cache;
+    return Cache.Get(Record).MemberFunctions;
+}
+
+RecordSummary const & RecordSummaryCache::Get(clang::CXXRecordDecl const * const Record) {
+    clang::CXXRecordDecl const * const Definition =
+        Record->hasDefinition() ? Record->getDefinition() : Record;
+    auto const Key = Definition->getCanonicalDecl();
+    {
+        auto const It = Summaries.find(Key);
+        if (Summaries.end() != It) {
+            return *(It->second);
         }
     }
-    return Result;
+    // The hierarchy is walked once, with a visited set, therefore a base
+    // class which is reachable on multiple paths is visited only once. The
+    // members are collected and sorted at the end, instead of merging the
+    // summaries of the bases level by level (which would copy the members
+    // of a deep hierarchy once per level).
+    llvm::SmallVector<clang::DeclaratorDecl const *, 16> Fields;
+    llvm::SmallVector<clang::CXXMethodDecl const *, 16> Functions;
+    llvm::SmallPtrSet<clang::CXXRecordDecl const *, 8> Visited;
+    llvm::SmallVector<clang::CXXRecordDecl const *, 8> Works;
+    Works.push_back(Definition);
+    Visited.insert(Definition);
+    while (! Works.empty()) {
+        clang::CXXRecordDecl const * const Current = Works.pop_back_val();
+        for (const auto & FieldIt : Current->fields()) {
+            Fields.push_back(FieldIt);
+        }
+        for (auto const & MethodIt : Current->methods()) {
+            Functions.push_back(MethodIt->getCanonicalDecl());
+        }
+        if (! Current->hasDefinition())
+            continue;
+        for (const auto & BaseIt : Current->bases()) {
+            if (auto const * BaseType = BaseIt.getType()->getAs<clang::RecordType>()) {
+                if (auto const * Base = clang::cast_or_null<clang::CXXRecordDecl>(BaseType->getDecl()->getDefinition())) {
+                    if (Visited.insert(Base).second) {
+                        Works.push_back(Base);
+                    }
+                }
+            }
+        }
+    }
+    std::unique_ptr<RecordSummary> Result = std::make_unique<RecordSummary>();
+    Result->MemberVariables.insert(Fields.begin(), Fields.end());
+    Result->MemberFunctions.insert(Functions.begin(), Functions.end());
+    RecordSummary const & Inserted = *(Summaries[Key] = std::move(Result));
+    {
+        MemoryAccount::Phase const Accounting(MemoryPhase::DeclarationCollector);
+        Heap.Update(Summaries.getMemorySize() + Summaries.size() * sizeof(RecordSummary));
+    }
+    return Inserted;
 }
 
 Variables GetReferredVariables(clang::DeclaratorDecl const * const D) {
     Variables Result;
 
-    Variables Works;
-    Works.insert(D);
+    llvm::SmallVector<clang::DeclaratorDecl const *, 4> Works;
+    Works.push_back(D);
 
     while (! Works.empty()) {
         // get the current element
-        auto const Current = *(Works.begin());
-        Works.erase(Works.begin());
-        // current element goes into results
-        if (Current) {
-            Result.insert(Current);
-        } else {
+        auto const Current = Works.pop_back_val();
+        // current element goes into results (only once, the references
+        // might refer to each other)
+        if (! (Current && Result.insert(Current))) {
             continue;
         }
         // check is it reference or pointer type
@@ -176,24 +198,184 @@ Variables GetReferredVariables(clang::DeclaratorDecl const * const D) {
         if (auto const Variable = clang::dyn_cast<clang::VarDecl const>(Current)) {
             // get the initialization expression
             for (auto && Expression: CollectRefereeExpr(Variable->getInit())) {
-                Works.insert(GetDeclarationFromExpr(Expression));
+                Works.push_back(GetDeclarationFromExpr(Expression));
             }
         }
     }
     return Result;
 }
 
-Variables GetMemberVariablesAndReferences(clang::CXXRecordDecl const * const Rec, clang::DeclContext const * const F) {
-    Variables Members = GetVariablesFromRecord(Rec);
-    Variables const & Locals = GetVariablesFromContext(F);
-    for (auto const &Local : Locals) {
-        Variables const &Refs = GetReferredVariables(Local);
-        for (auto ReIt(Refs.begin()), ReEnd(Refs.end()); ReIt != ReEnd; ++ReIt) {
-            if (Members.count(*ReIt)) {
-                Members.insert(Refs.begin(), Refs.end());
-                break;
+AliasGraph::AliasGraph(clang::DeclContext const * const F)
+    : Index()
+    , Nodes()
+    , Referees()
+    , Referrers()
+    , Heap()
+{
+    for (auto && Local : GetVariablesFromContext(F)) {
+        Add(Local);
+    }
+    MemoryAccount::Phase const Accounting(MemoryPhase::DeclarationCollector);
+    Heap.Update(GetHeapBytes());
+}
+
+// The edge lists are counted when those grew out of their inline storage.
+std::size_t AliasGraph::GetHeapBytes() const {
+    std::size_t Result = Index.getMemorySize()
+        + Nodes.capacity() * sizeof(clang::DeclaratorDecl const *)
+        + (Referees.capacity() + Referrers.capacity()) * sizeof(llvm::SmallVector<unsigned, 2>);
+    for (auto const & Edges : { &Referees, &Referrers }) {
+        for (auto && Edge : *Edges) {
+            Result += (Edge.capacity() > 2) ? (Edge.capacity() * sizeof(unsigned)) : 0;
+        }
+    }
+    return Result;
+}
+
+// The node of the declaration is created with the nodes of all its
+// (transitive) referees, unless it was already in the graph.
+unsigned AliasGraph::Add(clang::DeclaratorDecl const * const D) {
+    auto const Inserted = Index.insert(std::make_pair(D, unsigned(Nodes.size())));
+    if (! Inserted.second)
+        return Inserted.first->second;
+
+    unsigned const Result = Inserted.first->second;
+    Nodes.push_back(D);
+    Referees.emplace_back();
+    Referrers.emplace_back();
+
+    llvm::SmallVector<unsigned, 16> Works;
+    Works.push_back(Result);
+    while (! Works.empty()) {
+        unsigned const Current = Works.pop_back_val();
+        auto const & T = Nodes[Current]->getType();
+        if (! ((*T).isReferenceType() || (*T).isPointerType()))
+            continue;
+        auto const Variable = clang::dyn_cast<clang::VarDecl const>(Nodes[Current]);
+        if (! Variable)
+            continue;
+        for (auto && Expression: CollectRefereeExpr(Variable->getInit())) {
+            auto const Referee = GetDeclarationFromExpr(Expression);
+            if (! Referee)
+                continue;
+            auto const Found = Index.insert(std::make_pair(Referee, unsigned(Nodes.size())));
+            unsigned const Node = Found.first->second;
+            if (Found.second) {
+                Nodes.push_back(Referee);
+                Referees.emplace_back();
+                Referrers.emplace_back();
+                Works.push_back(Node);
             }
+            Referees[Current].push_back(Node);
+            Referrers[Node].push_back(Current);
         }
     }
+    return Result;
+}
+
+// The referred sets of the roots are walked together, so the declarations
+// which are shared by them are visited only once.
+void AliasGraph::ForEachReferred(llvm::ArrayRef<clang::DeclaratorDecl const *> const Roots,
+                                 llvm::function_ref<void (clang::DeclaratorDecl const *)> const Function) {
+    llvm::SmallVector<unsigned, 16> Works;
+    std::size_t const Known = Nodes.size();
+    for (auto && Root : Roots) {
+        Works.push_back(Add(Root));
+    }
+    if (Known != Nodes.size()) {
+        MemoryAccount::Phase const Accounting(MemoryPhase::DeclarationCollector);
+        Heap.Update(GetHeapBytes());
+    }
+    std::vector<bool> Visited(Nodes.size(), false);
+    while (! Works.empty()) {
+        unsigned const Current = Works.pop_back_val();
+        if (Visited[Current])
+            continue;
+        Visited[Current] = true;
+        Function(Nodes[Current]);
+        Works.append(Referees[Current].begin(), Referees[Current].end());
+    }
+}
+
+Variables AliasGraph::GetReferrers(clang::DeclaratorDecl const * const D, Variables const & Among) {
+    llvm::SmallVector<clang::DeclaratorDecl const *, 8> Result;
+    llvm::SmallVector<unsigned, 16> Works;
+    std::size_t const Known = Nodes.size();
+    Works.push_back(Add(D));
+    if (Known != Nodes.size()) {
+        MemoryAccount::Phase const Accounting(MemoryPhase::DeclarationCollector);
+        Heap.Update(GetHeapBytes());
+    }
+    std::vector<bool> Visited(Nodes.size(), false);
+    while (! Works.empty()) {
+        unsigned const Current = Works.pop_back_val();
+        if (Visited[Current])
+            continue;
+        Visited[Current] = true;
+        if (Nodes[Current] == D || Among.count(Nodes[Current])) {
+            Result.push_back(Nodes[Current]);
+        }
+        Works.append(Referrers[Current].begin(), Referrers[Current].end());
+    }
+    return Variables(Result.begin(), Result.end());
+}
+
+// A variable is a member reference, when it refers to a member variable,
+// or it shares a referee with a member reference. Therefore the member
+// references are the declarations which are connected (in any direction,
+// but not through a member variable) to a member variable. These are
+// collected with union-find, instead of comparing the referred sets.
+Variables AliasGraph::GetMemberReferences(Variables const & Members) const {
+    std::vector<unsigned> Parent(Nodes.size());
+    for (unsigned Node = 0; Node < Nodes.size(); ++Node) {
+        Parent[Node] = Node;
+    }
+    auto const Find = [&Parent](unsigned Node) {
+        while (Parent[Node] != Node) {
+            Parent[Node] = Parent[Parent[Node]];
+            Node = Parent[Node];
+        }
+        return Node;
+    };
+    std::vector<bool> IsMember(Nodes.size(), false);
+    for (unsigned Node = 0; Node < Nodes.size(); ++Node) {
+        IsMember[Node] = Members.count(Nodes[Node]);
+    }
+    llvm::SmallVector<unsigned, 8> Seeds;
+    for (unsigned Node = 0; Node < Nodes.size(); ++Node) {
+        if (IsMember[Node])
+            continue;
+        for (auto && Referee : Referees[Node]) {
+            if (IsMember[Referee]) {
+                Seeds.push_back(Node);
+            } else {
+                Parent[Find(Node)] = Find(Referee);
+            }
+        }
+    }
+    std::vector<bool> Connected(Nodes.size(), false);
+    for (auto && Seed : Seeds) {
+        Connected[Find(Seed)] = true;
+    }
+    llvm::SmallVector<clang::DeclaratorDecl const *, 8> Result;
+    for (unsigned Node = 0; Node < Nodes.size(); ++Node) {
+        if (! IsMember[Node] && Connected[Find(Node)]) {
+            Result.push_back(Nodes[Node]);
+        }
+    }
+    return Variables(Result.begin(), Result.end());
+}
+
+Variables GetMemberVariablesAndReferences(clang::CXXRecordDecl const * const Rec, clang::DeclContext const * const F) {
+    RecordSummaryCache Cache;
+    RecordSummary const & Summary = Cache.Get(Rec);
+    Variables Members = Summary.MemberVariables;
+    Variables const & References = GetMemberReferences(Summary, F);
+    Members.insert(References.begin(), References.end());
     return Members;
 }
+
+Variables GetMemberReferences(RecordSummary const & Rec, clang::DeclContext const * const F) {
+    AliasGraph const Aliases(F);
+    return Aliases.GetMemberReferences(Rec.MemberVariables);
+}
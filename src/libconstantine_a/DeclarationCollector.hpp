@@ -19,12 +19,48 @@
 
 #pragma once
 
-#include <set>
+#include "FlatSet.hpp"
+#include "MemoryAccount.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
 
 #include <clang/AST/AST.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+typedef FlatSet<clang::DeclaratorDecl const *> Variables;
+typedef FlatSet<clang::CXXMethodDecl const *> Methods;
+
+// Member variables and methods of a class, including the ones inherited
+// from the base classes.
+struct RecordSummary {
+    Variables MemberVariables;
+    Methods MemberFunctions;
+};
+
+// Computes the record summaries on demand and keeps them for the whole
+// translation unit. Every method of a class gets the same summary instead
+// of walking the class hierarchy again.
+class RecordSummaryCache {
+public:
+    RecordSummaryCache()
+        : Summaries()
+        , Heap()
+    { }
 
-typedef std::set<clang::DeclaratorDecl const *> Variables;
-typedef std::set<clang::CXXMethodDecl const *> Methods;
+    RecordSummaryCache(RecordSummaryCache const &) = delete;
+    RecordSummaryCache & operator=(RecordSummaryCache const &) = delete;
+
+    RecordSummary const & Get(clang::CXXRecordDecl const * Rec);
+
+private:
+    llvm::DenseMap<clang::CXXRecordDecl const *, std::unique_ptr<RecordSummary>> Summaries;
+    HeapUsage Heap;
+};
 
 // method to copy variables out from declaration context
 Variables GetVariablesFromContext(clang::DeclContext const * F, bool WithoutArgs = false);
@@ -39,5 +75,47 @@ Methods GetMethodsFromRecord(clang::CXXRecordDecl const * Rec);
 // method to get referred declarations from the given declaration
 Variables GetReferredVariables(clang::DeclaratorDecl const *);
 
+// The references between the variables of one function. The edges (from a
+// reference or pointer variable to the declarations of its initializer) are
+// collected once per variable, and every query walks the graph once: the
+// referred sets of the single variables are never materialised. So, a chain
+// of references is not walked again for every variable on it.
+class AliasGraph {
+public:
+    // The graph is built from the variables of the given context.
+    explicit AliasGraph(clang::DeclContext const * F);
+
+    AliasGraph(AliasGraph const &) = delete;
+    AliasGraph & operator=(AliasGraph const &) = delete;
+
+    // Calls the function once with every declaration which is referred by
+    // any of the given ones (including themselves).
+    void ForEachReferred(llvm::ArrayRef<clang::DeclaratorDecl const *> Roots,
+                         llvm::function_ref<void (clang::DeclaratorDecl const *)> Function);
+
+    // The given declaration and those of the given variables which refer
+    // to it.
+    Variables GetReferrers(clang::DeclaratorDecl const * D, Variables const & Among);
+
+    // The declarations which are connected to the member variables through
+    // references (but not the member variables themself).
+    Variables GetMemberReferences(Variables const & Members) const;
+
+private:
+    unsigned Add(clang::DeclaratorDecl const *);
+    std::size_t GetHeapBytes() const;
+
+private:
+    llvm::DenseMap<clang::DeclaratorDecl const *, unsigned> Index;
+    std::vector<clang::DeclaratorDecl const *> Nodes;
+    std::vector<llvm::SmallVector<unsigned, 2>> Referees;
+    std::vector<llvm::SmallVector<unsigned, 2>> Referrers;
+    HeapUsage Heap;
+};
+
 // method to get all member variables and all referred declarations
 Variables GetMemberVariablesAndReferences(clang::CXXRecordDecl const * Rec, clang::DeclContext const * F);
+
+// method to get the declarations which refer to the member variables (but
+// not the member variables themself)
+Variables GetMemberReferences(RecordSummary const & Rec, clang::DeclContext const * F);
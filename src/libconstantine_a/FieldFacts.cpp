@@ -0,0 +1,330 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FieldFacts.hpp"
+
+#include <utility>
+
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/EndianStream.h>
+
+
+namespace {
+
+// Change it when the format or the meaning of the files change.
+uint32_t const FactsMagic = 0x43464631;     // CFF1
+uint32_t const DatabaseMagic = 0x43464431;  // CFD1
+
+// magic, number of facts, size of the strings
+std::size_t const FactsHeaderSize = 3 * 4;
+// offset of the USR, name and location, flags
+std::size_t const FactSize = 4 * 4;
+// magic, number of member variables, sources and facts, size of the strings
+std::size_t const DatabaseHeaderSize = 5 * 4;
+// offset of the USR, name and location
+std::size_t const FieldSize = 3 * 4;
+// offset of the path, number of facts, size, modification time
+std::size_t const SourceSize = 2 * 4 + 2 * 8;
+
+uint32_t const FlagMask = FieldFact::Changed | FieldFact::Defined;
+
+
+// The strings are written once, the records refer to them by offset.
+class StringTable {
+public:
+    StringTable()
+        : Offsets()
+        , Strings()
+        , Size(0)
+    { }
+
+    StringTable(StringTable const &) = delete;
+    StringTable & operator=(StringTable const &) = delete;
+
+    uint32_t Add(llvm::StringRef const String) {
+        auto const Inserted = Offsets.insert(std::make_pair(String, Size));
+        if (Inserted.second) {
+            Strings.push_back(Inserted.first->first());
+            Size += String.size() + 1;
+        }
+        return Inserted.first->second;
+    }
+
+    uint32_t GetSize() const {
+        return Size;
+    }
+
+    void Write(llvm::raw_ostream & Stream) const {
+        for (auto && String : Strings) {
+            Stream << String << '\0';
+        }
+    }
+
+private:
+    llvm::StringMap<uint32_t> Offsets;
+    std::vector<llvm::StringRef> Strings;
+    uint32_t Size;
+};
+
+bool GetString(llvm::StringRef const Strings, uint32_t const Offset, llvm::StringRef & Result) {
+    if (Offset >= Strings.size())
+        return false;
+
+    std::size_t const End = Strings.find('\0', Offset);
+    if (llvm::StringRef::npos == End)
+        return false;
+
+    Result = Strings.slice(Offset, End);
+    return true;
+}
+
+} // namespace anonymous
+
+
+void WriteFieldFacts(llvm::raw_ostream & Stream, std::vector<FieldFact> const & Facts) {
+    StringTable Strings;
+    std::vector<uint32_t> Offsets;
+    for (auto && Fact : Facts) {
+        Offsets.push_back(Strings.Add(Fact.USR));
+        Offsets.push_back(Strings.Add(Fact.Name));
+        Offsets.push_back(Strings.Add(Fact.Location));
+    }
+
+    llvm::support::endian::Writer Writer(Stream, llvm::support::little);
+    Writer.write<uint32_t>(FactsMagic);
+    Writer.write<uint32_t>(Facts.size());
+    Writer.write<uint32_t>(Strings.GetSize());
+    for (std::size_t It = 0; It < Facts.size(); ++It) {
+        Writer.write<uint32_t>(Offsets[It * 3]);
+        Writer.write<uint32_t>(Offsets[It * 3 + 1]);
+        Writer.write<uint32_t>(Offsets[It * 3 + 2]);
+        Writer.write<uint32_t>(Facts[It].Flags & FlagMask);
+    }
+    Strings.Write(Stream);
+}
+
+bool ReadFieldFacts(llvm::StringRef const Content, llvm::function_ref<void(FieldFact const &)> const Callback) {
+    if (Content.size() < FactsHeaderSize)
+        return false;
+
+    using namespace llvm::support;
+    auto const Base = reinterpret_cast<unsigned char const *>(Content.data());
+    if (FactsMagic != endian::read32le(Base))
+        return false;
+    uint64_t const Count = endian::read32le(Base + 4);
+    uint64_t const StringsSize = endian::read32le(Base + 8);
+    if (Content.size() != FactsHeaderSize + Count * FactSize + StringsSize)
+        return false;
+
+    llvm::StringRef const Strings = Content.take_back(StringsSize);
+    for (uint64_t It = 0; It < Count; ++It) {
+        unsigned char const * const Record = Base + FactsHeaderSize + It * FactSize;
+        FieldFact Fact = { llvm::StringRef(), llvm::StringRef(), llvm::StringRef(), endian::read32le(Record + 12) };
+        if (! (GetString(Strings, endian::read32le(Record), Fact.USR)
+            && GetString(Strings, endian::read32le(Record + 4), Fact.Name)
+            && GetString(Strings, endian::read32le(Record + 8), Fact.Location)))
+            return false;
+        if (0 != (Fact.Flags & ~FlagMask))
+            return false;
+        Callback(Fact);
+    }
+    return true;
+}
+
+
+FieldDatabase::FieldDatabase()
+    : Fields()
+    , Index()
+    , Sources()
+{ }
+
+bool FieldDatabase::Read(llvm::StringRef const Content) {
+    Fields.clear();
+    Index.clear();
+    Sources.clear();
+    auto const Fail = [this]() {
+        Fields.clear();
+        Index.clear();
+        Sources.clear();
+        return false;
+    };
+    if (Content.size() < DatabaseHeaderSize)
+        return false;
+
+    using namespace llvm::support;
+    auto const Base = reinterpret_cast<unsigned char const *>(Content.data());
+    if (DatabaseMagic != endian::read32le(Base))
+        return false;
+    uint64_t const FieldCount = endian::read32le(Base + 4);
+    uint64_t const SourceCount = endian::read32le(Base + 8);
+    uint64_t const FactCount = endian::read32le(Base + 12);
+    uint64_t const StringsSize = endian::read32le(Base + 16);
+    if (Content.size() != DatabaseHeaderSize + FieldCount * FieldSize + SourceCount * SourceSize + FactCount * 4 + StringsSize)
+        return false;
+
+    llvm::StringRef const Strings = Content.take_back(StringsSize);
+    unsigned char const * Data = Base + DatabaseHeaderSize;
+    for (uint64_t It = 0; It < FieldCount; ++It, Data += FieldSize) {
+        FieldFact Fact = { llvm::StringRef(), llvm::StringRef(), llvm::StringRef(), 0 };
+        if (! (GetString(Strings, endian::read32le(Data), Fact.USR)
+            && GetString(Strings, endian::read32le(Data + 4), Fact.Name)
+            && GetString(Strings, endian::read32le(Data + 8), Fact.Location)))
+            return Fail();
+        if (It != Add(Fact))
+            return Fail();
+    }
+    unsigned char const * Facts = Data + SourceCount * SourceSize;
+    uint64_t FactsLeft = FactCount;
+    for (uint64_t It = 0; It < SourceCount; ++It, Data += SourceSize) {
+        llvm::StringRef Path;
+        if (! GetString(Strings, endian::read32le(Data), Path))
+            return Fail();
+        uint32_t const SourceFacts = endian::read32le(Data + 4);
+        if ((SourceFacts > FactsLeft) || Sources.count(Path.str()))
+            return Fail();
+        SourceEntry & Entry = Sources[Path.str()];
+        Entry.When = Stamp { endian::read64le(Data + 8), endian::read64le(Data + 16) };
+        for (uint32_t Fact = 0; Fact < SourceFacts; ++Fact, Facts += 4) {
+            uint32_t const Packed = endian::read32le(Facts);
+            if ((Packed >> 2) >= Fields.size())
+                return Fail();
+            Entry.Facts.push_back(Packed);
+            Count(Packed, true);
+        }
+        FactsLeft -= SourceFacts;
+    }
+    return (0 == FactsLeft) || Fail();
+}
+
+void FieldDatabase::Write(llvm::raw_ostream & Stream) const {
+    // The member variables are renumbered, to drop those without facts.
+    uint32_t const Unused = ~0u;
+    std::vector<uint32_t> Renumbered(Fields.size(), Unused);
+    std::vector<uint32_t> Kept;
+    uint32_t FactCount = 0;
+    for (auto && Source : Sources) {
+        for (auto const Packed : Source.second.Facts) {
+            uint32_t & Number = Renumbered[Packed >> 2];
+            if (Unused == Number) {
+                Number = Kept.size();
+                Kept.push_back(Packed >> 2);
+            }
+        }
+        FactCount += Source.second.Facts.size();
+    }
+    StringTable Strings;
+    std::vector<uint32_t> Offsets;
+    for (auto const Field : Kept) {
+        Offsets.push_back(Strings.Add(Fields[Field].USR));
+        Offsets.push_back(Strings.Add(Fields[Field].Name));
+        Offsets.push_back(Strings.Add(Fields[Field].Location));
+    }
+    for (auto && Source : Sources) {
+        Offsets.push_back(Strings.Add(Source.first));
+    }
+
+    llvm::support::endian::Writer Writer(Stream, llvm::support::little);
+    Writer.write<uint32_t>(DatabaseMagic);
+    Writer.write<uint32_t>(Kept.size());
+    Writer.write<uint32_t>(Sources.size());
+    Writer.write<uint32_t>(FactCount);
+    Writer.write<uint32_t>(Strings.GetSize());
+    auto Offset = Offsets.begin();
+    for (std::size_t It = 0; It < Kept.size() * 3; ++It) {
+        Writer.write<uint32_t>(*Offset++);
+    }
+    for (auto && Source : Sources) {
+        Writer.write<uint32_t>(*Offset++);
+        Writer.write<uint32_t>(Source.second.Facts.size());
+        Writer.write<uint64_t>(Source.second.When.Size);
+        Writer.write<uint64_t>(Source.second.When.Modified);
+    }
+    for (auto && Source : Sources) {
+        for (auto const Packed : Source.second.Facts) {
+            Writer.write<uint32_t>((Renumbered[Packed >> 2] << 2) | (Packed & FlagMask));
+        }
+    }
+    Strings.Write(Stream);
+}
+
+bool FieldDatabase::IsCurrent(llvm::StringRef const Source, Stamp const & When) const {
+    auto const It = Sources.find(Source.str());
+    return (Sources.end() != It) && (It->second.When == When);
+}
+
+bool FieldDatabase::Update(llvm::StringRef const Source, Stamp const & When, llvm::StringRef const Content) {
+    Remove(Source);
+    // The facts are checked before any of them is counted.
+    std::vector<FieldFact> Facts;
+    if (! ReadFieldFacts(Content, [&Facts](FieldFact const & Fact) { Facts.push_back(Fact); }))
+        return false;
+
+    SourceEntry & Entry = Sources[Source.str()];
+    Entry.When = When;
+    for (auto && Fact : Facts) {
+        uint32_t const Packed = (Add(Fact) << 2) | Fact.Flags;
+        Entry.Facts.push_back(Packed);
+        Count(Packed, true);
+    }
+    return true;
+}
+
+void FieldDatabase::Remove(llvm::StringRef const Source) {
+    auto const It = Sources.find(Source.str());
+    if (Sources.end() == It)
+        return;
+
+    for (auto const Packed : It->second.Facts) {
+        Count(Packed, false);
+    }
+    Sources.erase(It);
+}
+
+std::vector<std::string> FieldDatabase::GetSources() const {
+    std::vector<std::string> Result;
+    for (auto && Source : Sources) {
+        Result.push_back(Source.first);
+    }
+    return Result;
+}
+
+void FieldDatabase::ForEachConst(llvm::function_ref<void(FieldFact const &)> const Callback) const {
+    for (auto && Field : Fields) {
+        if ((0 == Field.Changed) && (0 != Field.Unchanged) && (0 != Field.Defined)) {
+            Callback(FieldFact { Field.USR, Field.Name, Field.Location, FieldFact::Defined });
+        }
+    }
+}
+
+uint32_t FieldDatabase::Add(FieldFact const & Fact) {
+    auto const Inserted = Index.insert(std::make_pair(Fact.USR, uint32_t(Fields.size())));
+    if (Inserted.second) {
+        Fields.push_back(FieldEntry { Fact.USR.str(), Fact.Name.str(), Fact.Location.str(), 0, 0, 0 });
+    }
+    return Inserted.first->second;
+}
+
+void FieldDatabase::Count(uint32_t const Packed, bool const Added) {
+    FieldEntry & Field = Fields[Packed >> 2];
+    uint32_t & Verdict = (0 != (Packed & FieldFact::Changed)) ? Field.Changed : Field.Unchanged;
+    Verdict = (Added) ? (Verdict + 1) : (Verdict - 1);
+    if (0 != (Packed & FieldFact::Defined)) {
+        Field.Defined = (Added) ? (Field.Defined + 1) : (Field.Defined - 1);
+    }
+}
@@ -0,0 +1,125 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+// What a translation unit knows about a member variable. The member
+// variables are identified by their USR across the translation units.
+struct FieldFact {
+    enum Flag : uint32_t {
+        // A function of the translation unit changes it.
+        Changed = 1,
+        // It is declared in an analysed file (the main file, or a user
+        // header with -analyze-headers), so it can be reported.
+        Defined = 2
+    };
+
+    llvm::StringRef USR;
+    llvm::StringRef Name;
+    // The location of the declaration ("file:line:column").
+    llvm::StringRef Location;
+    uint32_t Flags;
+};
+
+// The fact file of a translation unit: the header (magic, number of the
+// facts and size of the string table), the facts as fixed size records
+// (offsets of the strings and the flags), then the nul terminated strings.
+// It is read in place (memory mapped), the facts refer to the content.
+void WriteFieldFacts(llvm::raw_ostream &, std::vector<FieldFact> const &);
+
+// Returns false when the content is not a valid fact file.
+bool ReadFieldFacts(llvm::StringRef Content, llvm::function_ref<void(FieldFact const &)>);
+
+
+// The whole program verdict of the member variables: a member variable can
+// be const when no translation unit changes it. The database keeps the
+// facts of every fact file it was updated with, so, when a few
+// translation units are rebuilt, only their fact files are read again.
+class FieldDatabase {
+public:
+    // A fact file is considered unchanged while its size and modification
+    // time are the same.
+    struct Stamp {
+        uint64_t Size;
+        uint64_t Modified;
+
+        bool operator==(Stamp const & Other) const {
+            return (Size == Other.Size) && (Modified == Other.Modified);
+        }
+    };
+
+    FieldDatabase();
+
+    FieldDatabase(FieldDatabase const &) = delete;
+    FieldDatabase & operator=(FieldDatabase const &) = delete;
+
+    // Returns false when the content is not a valid database. (The
+    // database is left empty then.)
+    bool Read(llvm::StringRef Content);
+    // The member variables without facts are not written.
+    void Write(llvm::raw_ostream &) const;
+
+    bool IsCurrent(llvm::StringRef Source, Stamp const &) const;
+    // Replace the facts of the source with the content of its fact file.
+    // Returns false when the content is not a valid fact file, the facts
+    // of the source are removed then.
+    bool Update(llvm::StringRef Source, Stamp const &, llvm::StringRef Content);
+    void Remove(llvm::StringRef Source);
+    std::vector<std::string> GetSources() const;
+
+    // Calls the function with the member variables which no translation
+    // unit changes, but some of them uses and some of them defines.
+    void ForEachConst(llvm::function_ref<void(FieldFact const &)>) const;
+
+private:
+    struct FieldEntry {
+        std::string USR;
+        std::string Name;
+        std::string Location;
+        uint32_t Changed;
+        uint32_t Unchanged;
+        uint32_t Defined;
+    };
+
+    struct SourceEntry {
+        Stamp When;
+        // index of the member variable shifted left by two, the lowest
+        // bits are the flags of the fact.
+        std::vector<uint32_t> Facts;
+    };
+
+    uint32_t Add(FieldFact const &);
+    void Count(uint32_t Fact, bool Added);
+
+private:
+    std::vector<FieldEntry> Fields;
+    llvm::StringMap<uint32_t> Index;
+    std::map<std::string, SourceEntry> Sources;
+};
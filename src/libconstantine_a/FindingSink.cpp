@@ -0,0 +1,405 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FindingSink.hpp"
+#include "FixIts.hpp"
+#include "Replacements.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include <clang/Index/USRGeneration.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace {
+
+char const * GetKindName(Finding::Kind const Kind) {
+    switch (Kind) {
+        case Finding::Variable: return "variable";
+        case Finding::ConstFunction: return "function-const";
+        case Finding::StaticFunction: return "function-static";
+    }
+    return "";
+}
+
+std::string GetMessage(Finding const & F) {
+    switch (F.What) {
+        case Finding::Variable: return "variable '" + GetName(F) + "' could be declared as const";
+        case Finding::ConstFunction: return "function '" + GetName(F) + "' could be declared as const";
+        case Finding::StaticFunction: return "function '" + GetName(F) + "' could be declared as static";
+    }
+    return std::string();
+}
+
+
+// The diagnostic IDs are registered once, and the declarations are passed
+// to the diagnostics engine, which prints their names (quoted) only when
+// needed. Replayed findings have the name only, that is quoted here.
+class DiagnosticSink : public FindingSink {
+public:
+    DiagnosticSink(clang::DiagnosticsEngine & DE, clang::SourceManager const & SM, clang::LangOptions const & LO)
+        : FindingSink()
+        , Reporter(DE)
+        , Sources(SM)
+        , Options(LO)
+        , VariableId(DE.getCustomDiagID(clang::DiagnosticsEngine::Warning, "variable %0 could be declared as const"))
+        , ConstFunctionId(DE.getCustomDiagID(clang::DiagnosticsEngine::Warning, "function %0 could be declared as const"))
+        , StaticFunctionId(DE.getCustomDiagID(clang::DiagnosticsEngine::Warning, "function %0 could be declared as static"))
+    { }
+
+    void Report(llvm::ArrayRef<Finding> const Findings) override {
+        for (auto && F : Findings) {
+            clang::DiagnosticBuilder const DB = Reporter.Report(F.Location, GetId(F.What));
+            if (F.Decl) {
+                DB << F.Decl;
+            } else {
+                DB << ("'" + F.Name + "'");
+            }
+            for (auto && Hint : GetFixIts(F, Sources, Options)) {
+                DB << Hint;
+            }
+            DB.setForceEmit();
+        }
+    }
+
+private:
+    unsigned GetId(Finding::Kind const Kind) const {
+        switch (Kind) {
+            case Finding::Variable: return VariableId;
+            case Finding::ConstFunction: return ConstFunctionId;
+            case Finding::StaticFunction: return StaticFunctionId;
+        }
+        return VariableId;
+    }
+
+private:
+    clang::DiagnosticsEngine & Reporter;
+    clang::SourceManager const & Sources;
+    clang::LangOptions const & Options;
+    unsigned const VariableId;
+    unsigned const ConstFunctionId;
+    unsigned const StaticFunctionId;
+};
+
+
+// Base of the file sinks. The output is buffered by the stream.
+class FileSink : public FindingSink {
+protected:
+    FileSink(std::string const & Path, clang::DiagnosticsEngine & DE, clang::SourceManager const & SM)
+        : FindingSink()
+        , Error()
+        , Stream(Path, Error, llvm::sys::fs::OF_Text)
+        , Sources(SM)
+    {
+        if (Error) {
+            unsigned const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Error, "cannot open output file '%0': %1");
+            DE.Report(Id) << Path << Error.message();
+        }
+    }
+
+    bool IsOpen() const {
+        return ! Error;
+    }
+
+    void WriteLocation(llvm::json::OStream & J, clang::SourceLocation const Location) const {
+        clang::PresumedLoc const Presumed = Sources.getPresumedLoc(Sources.getExpansionLoc(Location));
+        if (Presumed.isValid()) {
+            J.attribute("file", Presumed.getFilename());
+            J.attribute("line", Presumed.getLine());
+            J.attribute("column", Presumed.getColumn());
+        }
+    }
+
+protected:
+    std::error_code Error;
+    llvm::raw_fd_ostream Stream;
+    clang::SourceManager const & Sources;
+};
+
+// One JSON object per line.
+class JsonLinesSink : public FileSink {
+public:
+    JsonLinesSink(std::string const & Path, clang::DiagnosticsEngine & DE, clang::SourceManager const & SM)
+        : FileSink(Path, DE, SM)
+    { }
+
+    void Report(llvm::ArrayRef<Finding> const Findings) override {
+        if (! IsOpen())
+            return;
+
+        for (auto && F : Findings) {
+            {
+                llvm::json::OStream J(Stream);
+                J.object([&] {
+                    J.attribute("kind", GetKindName(F.What));
+                    J.attribute("name", GetName(F));
+                    J.attribute("usr", GetUSR(F));
+                    J.attribute("function", GetFunction(F));
+                    WriteLocation(J, F.Location);
+                });
+            }
+            Stream << '\n';
+        }
+    }
+};
+
+// SARIF 2.1.0 log. The results are streamed while the surrounding log
+// object is kept open till the end of the translation unit.
+class SarifSink : public FileSink {
+public:
+    SarifSink(std::string const & Path, clang::DiagnosticsEngine & DE, clang::SourceManager const & SM)
+        : FileSink(Path, DE, SM)
+        , J(Stream)
+    {
+        if (! IsOpen())
+            return;
+
+        J.objectBegin();
+        J.attribute("$schema", "https://json.schemastore.org/sarif-2.1.0.json");
+        J.attribute("version", "2.1.0");
+        J.attributeBegin("runs");
+        J.arrayBegin();
+        J.objectBegin();
+        J.attributeObject("tool", [&] {
+            J.attributeObject("driver", [&] {
+                J.attribute("name", "constantine");
+                J.attributeArray("rules", [&] {
+                    for (auto const Kind : { Finding::Variable, Finding::ConstFunction, Finding::StaticFunction }) {
+                        J.object([&] {
+                            J.attribute("id", GetKindName(Kind));
+                        });
+                    }
+                });
+            });
+        });
+        J.attributeBegin("results");
+        J.arrayBegin();
+    }
+
+    ~SarifSink() override {
+        if (! IsOpen())
+            return;
+
+        J.arrayEnd();
+        J.attributeEnd();
+        J.objectEnd();
+        J.arrayEnd();
+        J.attributeEnd();
+        J.objectEnd();
+        Stream << '\n';
+    }
+
+    void Report(llvm::ArrayRef<Finding> const Findings) override {
+        if (! IsOpen())
+            return;
+
+        for (auto && F : Findings) {
+            Report(F);
+        }
+    }
+
+private:
+    void Report(Finding const & F) {
+        J.object([&] {
+            J.attribute("ruleId", GetKindName(F.What));
+            J.attribute("level", "warning");
+            J.attributeObject("message", [&] {
+                J.attribute("text", GetMessage(F));
+            });
+            J.attributeArray("locations", [&] {
+                J.object([&] {
+                    WritePhysicalLocation(F.Location);
+                    J.attributeArray("logicalLocations", [&] {
+                        J.object([&] {
+                            J.attribute("name", GetName(F));
+                            J.attribute("fullyQualifiedName", GetFunction(F));
+                            J.attribute("decoratedName", GetUSR(F));
+                        });
+                    });
+                });
+            });
+        });
+    }
+
+    void WritePhysicalLocation(clang::SourceLocation const Location) {
+        clang::PresumedLoc const Presumed = Sources.getPresumedLoc(Sources.getExpansionLoc(Location));
+        if (Presumed.isInvalid())
+            return;
+
+        J.attributeObject("physicalLocation", [&] {
+            J.attributeObject("artifactLocation", [&] {
+                J.attribute("uri", Presumed.getFilename());
+            });
+            J.attributeObject("region", [&] {
+                J.attribute("startLine", Presumed.getLine());
+                J.attribute("startColumn", Presumed.getColumn());
+            });
+        });
+    }
+
+private:
+    llvm::json::OStream J;
+};
+
+// The fix-its of the findings, in the clang-apply-replacements format.
+// The same edit is written once per translation unit. (Different
+// translation units have the same header edits, those are deduplicated
+// by the merge tool.) The edits of the member variables are tagged, the
+// merge tool keeps those only with the whole program verdict.
+class ReplacementsSink : public FileSink {
+public:
+    ReplacementsSink(std::string const & Path, clang::DiagnosticsEngine & DE, clang::SourceManager const & SM, clang::LangOptions const & LO)
+        : FileSink(Path, DE, SM)
+        , Options(LO)
+        , Written()
+    {
+        if (! IsOpen())
+            return;
+
+        clang::FileEntry const * const Entry = SM.getFileEntryForID(SM.getMainFileID());
+        WriteReplacementsBegin(Stream, (nullptr == Entry)
+            ? llvm::StringRef()
+            : (Entry->tryGetRealPathName().empty() ? Entry->getName() : Entry->tryGetRealPathName()));
+    }
+
+    ~ReplacementsSink() override {
+        if (! IsOpen())
+            return;
+
+        WriteReplacementsEnd(Stream);
+    }
+
+    void Report(llvm::ArrayRef<Finding> const Findings) override {
+        if (! IsOpen())
+            return;
+
+        for (auto && F : Findings) {
+            std::string const Field = (F.Decl && clang::isa<clang::FieldDecl>(F.Decl)) ? GetUSR(F) : std::string();
+            for (auto && Hint : GetFixIts(F, Sources, Options)) {
+                Replacement R;
+                R.Field = Field;
+                if (GetReplacement(Hint, Sources, Options, R) && Written.insert(GetKey(R)).second) {
+                    WriteReplacement(Stream, R);
+                }
+            }
+        }
+    }
+
+private:
+    static std::string GetKey(Replacement const & R) {
+        return R.FilePath + '\0' + std::to_string(R.Offset) + '\0' + std::to_string(R.Length) + '\0' + R.Text;
+    }
+
+private:
+    clang::LangOptions const & Options;
+    std::set<std::string> Written;
+};
+
+} // namespace anonymous
+
+
+std::string GetOutputPath(std::string const & Directory, clang::SourceManager const & SM, llvm::StringRef const Extension) {
+    clang::FileEntry const * const Entry = SM.getFileEntryForID(SM.getMainFileID());
+    llvm::StringRef const Path = (nullptr == Entry)
+        ? llvm::StringRef("stdin")
+        : (Entry->tryGetRealPathName().empty() ? Entry->getName() : Entry->tryGetRealPathName());
+
+    llvm::MD5 Hash;
+    Hash.update(Path);
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+
+    llvm::SmallString<256> Output(Directory);
+    llvm::sys::path::append(Output,
+        llvm::sys::path::filename(Path) + "-" + Result.digest().str().substr(0, 16) + Extension);
+    return Output.str().str();
+}
+
+Finding MakeFinding(Finding::Kind const Kind, clang::DeclaratorDecl const * const D) {
+    return Finding { Kind, D->getBeginLoc(), D, std::string(), std::string(), std::string() };
+}
+
+std::string GetName(Finding const & F) {
+    return (F.Decl) ? F.Decl->getNameAsString() : F.Name;
+}
+
+std::string GetUSR(Finding const & F) {
+    if (! F.Decl)
+        return F.USR;
+
+    llvm::SmallString<128> USR;
+    return (clang::index::generateUSRForDecl(F.Decl, USR)) ? std::string() : USR.str().str();
+}
+
+std::string GetFunction(Finding const & F) {
+    if (! F.Decl)
+        return F.Function;
+
+    if (auto const Function = clang::dyn_cast<clang::FunctionDecl const>(F.Decl)) {
+        return Function->getQualifiedNameAsString();
+    }
+    if (auto const Function = clang::dyn_cast_or_null<clang::FunctionDecl const>(F.Decl->getParentFunctionOrMethod())) {
+        return Function->getQualifiedNameAsString();
+    }
+    return std::string();
+}
+
+void SortFindings(std::vector<Finding> & Findings, clang::SourceManager const & SM) {
+    clang::BeforeThanCompare<clang::SourceLocation> const IsBefore(SM);
+    // Declarations in one declaration statement share the begin location,
+    // those are ordered by their name location.
+    auto const NameLocation = [](Finding const & F) {
+        return (F.Decl) ? F.Decl->getLocation() : F.Location;
+    };
+    std::sort(Findings.begin(), Findings.end(), [&](Finding const & Lhs, Finding const & Rhs) {
+        if (Lhs.Location != Rhs.Location)
+            return IsBefore(Lhs.Location, Rhs.Location);
+        if (NameLocation(Lhs) != NameLocation(Rhs))
+            return IsBefore(NameLocation(Lhs), NameLocation(Rhs));
+        if (Lhs.What != Rhs.What)
+            return Lhs.What < Rhs.What;
+        return GetName(Lhs) < GetName(Rhs);
+    });
+}
+
+FindingSink::~FindingSink() = default;
+
+std::unique_ptr<FindingSink> CreateFindingSink(OutputFormat const Format,
+                                               std::string const & Directory,
+                                               clang::DiagnosticsEngine & DE,
+                                               clang::SourceManager const & SM,
+                                               clang::LangOptions const & LO) {
+    switch (Format) {
+        case OutputFormat::JsonLines:
+            return std::make_unique<JsonLinesSink>(GetOutputPath(Directory, SM, ".jsonl"), DE, SM);
+        case OutputFormat::Sarif:
+            return std::make_unique<SarifSink>(GetOutputPath(Directory, SM, ".sarif"), DE, SM);
+        case OutputFormat::Replacements:
+            return std::make_unique<ReplacementsSink>(GetOutputPath(Directory, SM, ".yaml"), DE, SM, LO);
+        case OutputFormat::Diagnostics:
+            break;
+    }
+    return std::make_unique<DiagnosticSink>(DE, SM, LO);
+}
@@ -0,0 +1,86 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <clang/AST/AST.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/LangOptions.h>
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+
+// A finding of the pseudo constness analysis. The strings are computed
+// from the declaration when needed. Findings which were replayed from the
+// header cache have no declaration, but the strings only.
+struct Finding {
+    enum Kind { Variable, ConstFunction, StaticFunction };
+
+    Kind What;
+    clang::SourceLocation Location;
+    clang::DeclaratorDecl const * Decl;
+    std::string Name;
+    // Unified symbol resolution of the declaration.
+    std::string USR;
+    // The enclosing function (of a variable), or the function itself.
+    std::string Function;
+};
+
+Finding MakeFinding(Finding::Kind, clang::DeclaratorDecl const *);
+
+std::string GetName(Finding const &);
+std::string GetUSR(Finding const &);
+std::string GetFunction(Finding const &);
+
+// Sort the findings by their location, to have the same output on every run.
+void SortFindings(std::vector<Finding> &, clang::SourceManager const &);
+
+// Output of the findings.
+class FindingSink {
+public:
+    FindingSink() = default;
+    virtual ~FindingSink();
+
+    FindingSink(FindingSink const &) = delete;
+    FindingSink & operator=(FindingSink const &) = delete;
+
+    // The findings are reported in one batch.
+    virtual void Report(llvm::ArrayRef<Finding>) = 0;
+};
+
+// The output file of a translation unit is named after the main file:
+// its name for readability and the hash of its path to be unique.
+std::string GetOutputPath(std::string const & Directory, clang::SourceManager const &, llvm::StringRef Extension);
+
+enum class OutputFormat { Diagnostics, JsonLines, Sarif, Replacements };
+
+// The diagnostics sink reports through the compiler (with fix-it hints).
+// The other formats are written into a file per translation unit in the
+// given directory. The replacements format has the fix-its only, as
+// clang-apply-replacements reads those.
+std::unique_ptr<FindingSink> CreateFindingSink(OutputFormat,
+                                               std::string const & Directory,
+                                               clang::DiagnosticsEngine &,
+                                               clang::SourceManager const &,
+                                               clang::LangOptions const &);
@@ -0,0 +1,230 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FixIts.hpp"
+
+#include <clang/AST/AST.h>
+#include <clang/AST/TypeLoc.h>
+#include <clang/Basic/CharInfo.h>
+#include <clang/Lex/Lexer.h>
+
+
+namespace {
+
+typedef std::vector<clang::FixItHint> FixIts;
+
+bool InsertBefore(clang::SourceLocation const Location, char const * const Text, FixIts & Result) {
+    if (Location.isInvalid() || Location.isMacroID())
+        return false;
+
+    Result.push_back(clang::FixItHint::CreateInsertion(Location, Text));
+    return true;
+}
+
+bool IsIndirect(clang::QualType const & Type) {
+    return Type->isReferenceType() || Type->isPointerType();
+}
+
+// The const applies to the variable, or to the referred object. It is not
+// inserted, when that would not convert implicitly (references to
+// pointers) or would not mean the same (arrays, functions).
+bool CanBeConstQualified(clang::QualType const & Type) {
+    clang::QualType const Object = IsIndirect(Type) ? Type->getPointeeType() : Type;
+    return (! Object.isNull())
+        && (! Object.isConstQualified())
+        && (! IsIndirect(Object))
+        && (! Object->isMemberPointerType())
+        && (! Object->isArrayType())
+        && (! Object->isFunctionType());
+}
+
+// Declarations in one declaration statement (int a, b;) share the type,
+// the edit would change all of those.
+bool IsSharedDeclaration(clang::DeclaratorDecl const * const V) {
+    for (auto const D : V->getLexicalDeclContext()->decls()) {
+        auto const Other = clang::dyn_cast<clang::DeclaratorDecl const>(D);
+        if (Other && (Other != V) && (Other->getTypeSpecStartLoc() == V->getTypeSpecStartLoc()))
+            return true;
+    }
+    return false;
+}
+
+// The const of a pointer goes after the last star (int * const p), before
+// the type it would make the pointed object const. It is not part of the
+// signature, so only the definition of a pointer parameter is edited. The
+// declarators of one declaration statement have their own stars.
+bool AddPointerEdits(clang::DeclaratorDecl const * const V,
+                     clang::SourceManager const & SM,
+                     clang::LangOptions const & LO,
+                     FixIts & Result) {
+    clang::TypeSourceInfo const * const Info = V->getTypeSourceInfo();
+    if (nullptr == Info)
+        return false;
+    auto const Pointer = Info->getTypeLoc().getUnqualifiedLoc().getAs<clang::PointerTypeLoc>();
+    if ((! Pointer) || Pointer.getStarLoc().isInvalid() || Pointer.getStarLoc().isMacroID())
+        return false;
+
+    clang::SourceLocation const Location = clang::Lexer::getLocForEndOfToken(Pointer.getStarLoc(), 0, SM, LO);
+    if (Location.isInvalid())
+        return false;
+    bool Invalid = false;
+    char const * const Next = SM.getCharacterData(Location, &Invalid);
+    bool const Separated = (! Invalid) && clang::isWhitespace(*Next);
+    Result.push_back(clang::FixItHint::CreateInsertion(Location, Separated ? " const" : " const "));
+    return true;
+}
+
+bool AddVariableEdits(clang::DeclaratorDecl const * const V,
+                      clang::SourceManager const & SM,
+                      clang::LangOptions const & LO,
+                      FixIts & Result) {
+    if (V->getType()->isPointerType())
+        return AddPointerEdits(V, SM, LO, Result);
+    if (! CanBeConstQualified(V->getType()))
+        return false;
+
+    // a value parameter is const in the definition only, but a reference
+    // parameter is part of the signature.
+    if (auto const P = clang::dyn_cast<clang::ParmVarDecl const>(V)) {
+        auto const F = clang::dyn_cast_or_null<clang::FunctionDecl const>(P->getDeclContext());
+        if (F && IsIndirect(P->getType())) {
+            unsigned const Index = P->getFunctionScopeIndex();
+            for (auto const Redecl : F->redecls()) {
+                if ((Index >= Redecl->getNumParams())
+                    || (! InsertBefore(Redecl->getParamDecl(Index)->getTypeSpecStartLoc(), "const ", Result)))
+                    return false;
+            }
+            return true;
+        }
+        return InsertBefore(P->getTypeSpecStartLoc(), "const ", Result);
+    }
+    if (IsSharedDeclaration(V))
+        return false;
+
+    return InsertBefore(V->getTypeSpecStartLoc(), "const ", Result);
+}
+
+clang::SourceLocation GetParametersEnd(clang::FunctionDecl const * const F) {
+    clang::FunctionTypeLoc const Loc = F->getFunctionTypeLoc();
+    return (Loc) ? Loc.getRParenLoc() : clang::SourceLocation();
+}
+
+bool AddConstEdits(clang::CXXMethodDecl const * const M,
+                   clang::SourceManager const & SM,
+                   clang::LangOptions const & LO,
+                   FixIts & Result) {
+    for (auto const Redecl : M->redecls()) {
+        clang::SourceLocation const RParen = GetParametersEnd(Redecl);
+        if (RParen.isInvalid() || RParen.isMacroID())
+            return false;
+
+        Result.push_back(clang::FixItHint::CreateInsertion(
+            clang::Lexer::getLocForEndOfToken(RParen, 0, SM, LO), " const"));
+    }
+    return true;
+}
+
+// The const qualifier of a method is after the parameter list, before
+// the body (or the end of the declaration).
+clang::CharSourceRange FindConstQualifier(clang::FunctionDecl const * const F,
+                                          clang::SourceManager const & SM,
+                                          clang::LangOptions const & LO) {
+    clang::SourceLocation Current = GetParametersEnd(F);
+    while (Current.isValid() && Current.isFileID()) {
+        llvm::Optional<clang::Token> const Next = clang::Lexer::findNextToken(Current, SM, LO);
+        if ((! Next) || Next->isOneOf(clang::tok::l_brace, clang::tok::semi, clang::tok::equal,
+                                      clang::tok::colon, clang::tok::arrow, clang::tok::eof))
+            break;
+        if (Next->is(clang::tok::raw_identifier) && (Next->getRawIdentifier() == "const"))
+            return clang::CharSourceRange::getCharRange(Next->getLocation(), Next->getEndLoc());
+        Current = Next->getLocation();
+    }
+    return clang::CharSourceRange();
+}
+
+bool AddStaticEdits(clang::CXXMethodDecl const * const M,
+                    clang::SourceManager const & SM,
+                    clang::LangOptions const & LO,
+                    FixIts & Result) {
+    // static methods can not have reference qualifier.
+    if (clang::RQ_None != M->getRefQualifier())
+        return false;
+
+    for (auto const Redecl : M->redecls()) {
+        if ((! Redecl->isOutOfLine()) && (! InsertBefore(Redecl->getInnerLocStart(), "static ", Result)))
+            return false;
+        if (M->isConst()) {
+            clang::CharSourceRange const Qualifier = FindConstQualifier(Redecl, SM, LO);
+            if (Qualifier.isInvalid())
+                return false;
+            Result.push_back(clang::FixItHint::CreateRemoval(Qualifier));
+        }
+    }
+    return true;
+}
+
+} // namespace anonymous
+
+
+std::vector<clang::FixItHint> GetFixIts(Finding const & F,
+                                        clang::SourceManager const & SM,
+                                        clang::LangOptions const & LO) {
+    FixIts Result;
+    bool Done = false;
+    if (F.Decl) {
+        switch (F.What) {
+            case Finding::Variable:
+                Done = AddVariableEdits(F.Decl, SM, LO, Result);
+                break;
+            case Finding::ConstFunction:
+                if (auto const M = clang::dyn_cast<clang::CXXMethodDecl const>(F.Decl))
+                    Done = AddConstEdits(M, SM, LO, Result);
+                break;
+            case Finding::StaticFunction:
+                if (auto const M = clang::dyn_cast<clang::CXXMethodDecl const>(F.Decl))
+                    Done = AddStaticEdits(M, SM, LO, Result);
+                break;
+        }
+    }
+    // the edits are made all, or none of them.
+    if (! Done)
+        Result.clear();
+    return Result;
+}
+
+bool GetReplacement(clang::FixItHint const & Hint,
+                    clang::SourceManager const & SM,
+                    clang::LangOptions const & LO,
+                    Replacement & Result) {
+    clang::CharSourceRange const Range = clang::Lexer::makeFileCharRange(Hint.RemoveRange, SM, LO);
+    if (Range.isInvalid())
+        return false;
+
+    std::pair<clang::FileID, unsigned> const Begin = SM.getDecomposedLoc(Range.getBegin());
+    std::pair<clang::FileID, unsigned> const End = SM.getDecomposedLoc(Range.getEnd());
+    clang::FileEntry const * const Entry = SM.getFileEntryForID(Begin.first);
+    if ((nullptr == Entry) || (Begin.first != End.first) || (Begin.second > End.second))
+        return false;
+
+    Result.FilePath = Entry->tryGetRealPathName().empty() ? Entry->getName().str() : Entry->tryGetRealPathName().str();
+    Result.Offset = Begin.second;
+    Result.Length = End.second - Begin.second;
+    Result.Text = Hint.CodeToInsert;
+    return true;
+}
@@ -0,0 +1,47 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "FindingSink.hpp"
+#include "Replacements.hpp"
+
+#include <vector>
+
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/LangOptions.h>
+#include <clang/Basic/SourceManager.h>
+
+
+// The edits which apply a finding: const is inserted before the type of a
+// variable (every declaration of a function is edited, when the parameter
+// type changes the signature), const is inserted after the parameter list
+// of a method (declaration and definition), static is inserted before the
+// method declaration (and its const is removed). It is empty, when the
+// finding has no declaration (it was replayed from the header cache) or
+// the edits can not be made safely (macros, declarations which share the
+// type, multi level pointers).
+std::vector<clang::FixItHint> GetFixIts(Finding const &,
+                                        clang::SourceManager const &,
+                                        clang::LangOptions const &);
+
+bool GetReplacement(clang::FixItHint const &,
+                    clang::SourceManager const &,
+                    clang::LangOptions const &,
+                    Replacement &);
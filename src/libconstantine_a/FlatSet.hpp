@@ -0,0 +1,135 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "MemoryAccount.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include <llvm/ADT/SmallVector.h>
+
+
+// Set stored in a sorted vector. The sets of this analysis are built once,
+// then looked up many times. Compared to a node based tree, it needs much
+// less allocation (none for small sets) and the lookup is cache friendly.
+template <typename T, unsigned N = 8>
+class FlatSet {
+    typedef llvm::SmallVector<T, N> Storage;
+
+public:
+    typedef T value_type;
+    typedef typename Storage::const_iterator iterator;
+    typedef typename Storage::const_iterator const_iterator;
+
+    FlatSet()
+        : Elements()
+        , Heap()
+    { }
+
+    template <typename I>
+    FlatSet(I First, I Last)
+        : Elements(First, Last)
+        , Heap()
+    {
+        Normalize();
+        Heap.Update(GetHeapBytes());
+    }
+
+    FlatSet(FlatSet const & Other)
+        : Elements(Other.Elements)
+        , Heap()
+    {
+        Heap.Update(GetHeapBytes());
+    }
+
+    FlatSet(FlatSet && Other) = default;
+
+    FlatSet & operator=(FlatSet const & Other) {
+        Elements = Other.Elements;
+        Heap.Update(GetHeapBytes());
+        return *this;
+    }
+
+    // The storage might keep its own buffer, when the other is small.
+    FlatSet & operator=(FlatSet && Other) {
+        Elements = std::move(Other.Elements);
+        Heap = std::move(Other.Heap);
+        Heap.Update(GetHeapBytes());
+        return *this;
+    }
+
+    const_iterator begin() const { return Elements.begin(); }
+    const_iterator end() const { return Elements.end(); }
+    bool empty() const { return Elements.empty(); }
+    std::size_t size() const { return Elements.size(); }
+
+    const_iterator find(T const & Value) const {
+        auto const It = std::lower_bound(Elements.begin(), Elements.end(), Value, std::less<T>());
+        return ((Elements.end() != It) && (*It == Value)) ? It : Elements.end();
+    }
+
+    std::size_t count(T const & Value) const {
+        return (end() == find(Value)) ? 0 : 1;
+    }
+
+    bool insert(T const & Value) {
+        auto const It = std::lower_bound(Elements.begin(), Elements.end(), Value, std::less<T>());
+        if ((Elements.end() != It) && (*It == Value))
+            return false;
+
+        Elements.insert(It, Value);
+        Heap.Update(GetHeapBytes());
+        return true;
+    }
+
+    template <typename I>
+    void insert(I First, I Last) {
+        Elements.append(First, Last);
+        Normalize();
+        Heap.Update(GetHeapBytes());
+    }
+
+    std::size_t erase(T const & Value) {
+        auto const It = std::lower_bound(Elements.begin(), Elements.end(), Value, std::less<T>());
+        if ((Elements.end() == It) || (*It != Value))
+            return 0;
+
+        Elements.erase(It);
+        return 1;
+    }
+
+private:
+    // The inline storage is not on the heap.
+    std::size_t GetHeapBytes() const {
+        return (Elements.capacity() > N) ? (Elements.capacity() * sizeof(T)) : 0;
+    }
+
+    void Normalize() {
+        std::sort(Elements.begin(), Elements.end(), std::less<T>());
+        Elements.erase(std::unique(Elements.begin(), Elements.end()), Elements.end());
+    }
+
+private:
+    Storage Elements;
+    HeapUsage Heap;
+};
@@ -0,0 +1,453 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FunctionCache.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <clang/AST/DeclTemplate.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/OnDiskHashTable.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace {
+
+// Change it when the format or the meaning of the records change.
+char const * const FormatVersion = "constantine-function-cache-1";
+uint32_t const Magic = 0x43464331; // "CFC1"
+
+// Hash the declarations which are referenced from the body. The ODR hash
+// of the body covers only the names of those, while the analysis depends
+// on their types too. (Like a callee takes its argument by reference.)
+//
+// For template instantiations the declarations of the instantiation itself
+// (its locals, and the members of its class) are hashed by their location
+// instead of their name. Those names contain the template arguments, while
+// the locations are shared by all instantiations of the same pattern.
+class ReferenceHasher
+    : public clang::RecursiveASTVisitor<ReferenceHasher> {
+public:
+    explicit ReferenceHasher(llvm::MD5 & Hash,
+                             clang::FunctionDecl const * const Self = nullptr,
+                             ParameterSummaries const * const Summaries = nullptr)
+        : clang::RecursiveASTVisitor<ReferenceHasher>()
+        , Hash(Hash)
+        , Self(Self)
+        , Summaries(Summaries)
+    { }
+
+    ReferenceHasher(ReferenceHasher const &) = delete;
+    ReferenceHasher & operator=(ReferenceHasher const &) = delete;
+
+    bool shouldVisitImplicitCode() const { return true; }
+
+    bool VisitDeclRefExpr(clang::DeclRefExpr const * const E) {
+        Add(E->getDecl());
+        return true;
+    }
+
+    bool VisitMemberExpr(clang::MemberExpr const * const E) {
+        Add(E->getMemberDecl());
+        return true;
+    }
+
+    bool VisitCXXConstructExpr(clang::CXXConstructExpr const * const E) {
+        Add(E->getConstructor());
+        return true;
+    }
+
+    // The type of a local decides if it can be a candidate at all.
+    bool VisitVarDecl(clang::VarDecl const * const D) {
+        if (Self) {
+            Add(D);
+        }
+        return true;
+    }
+
+    void Add(clang::ValueDecl const * const D) {
+        if (D) {
+            if (IsOwned(D)) {
+                uint32_t const Location = D->getLocation().getRawEncoding();
+                Hash.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<uint8_t const *>(&Location), sizeof(Location)));
+            } else {
+                Hash.update(D->getQualifiedNameAsString());
+            }
+            Hash.update(D->getType().getCanonicalType().getAsString());
+            if (auto const M = clang::dyn_cast<clang::CXXMethodDecl const>(D)) {
+                Hash.update(M->isStatic() ? "static" : "member");
+            }
+            // the result depends on the callee summary too
+            if (auto const F = clang::dyn_cast<clang::FunctionDecl const>(D)) {
+                if (Summaries) {
+                    Hash.update(Summaries->GetSignature(F));
+                }
+            }
+            Hash.update(llvm::StringRef("\0", 1));
+        }
+    }
+
+private:
+    bool IsOwned(clang::ValueDecl const * const D) const {
+        if (nullptr == Self)
+            return false;
+        if (D->getParentFunctionOrMethod() == Self)
+            return true;
+        auto const Method = clang::dyn_cast<clang::CXXMethodDecl const>(Self);
+        return Method && (D->getDeclContext() == Method->getParent());
+    }
+
+private:
+    llvm::MD5 & Hash;
+    clang::FunctionDecl const * const Self;
+    ParameterSummaries const * const Summaries;
+};
+
+void AddDeclaration(llvm::MD5 & Hash, clang::ValueDecl const * const D) {
+    Hash.update(D->getQualifiedNameAsString());
+    Hash.update(D->getType().getCanonicalType().getAsString());
+    Hash.update(llvm::StringRef("\0", 1));
+}
+
+void CollectFields(clang::CXXRecordDecl const * const Record,
+                   llvm::DenseSet<clang::CXXRecordDecl const *> & Visited,
+                   std::vector<clang::DeclaratorDecl const *> & Result) {
+    clang::CXXRecordDecl const * const Definition =
+        Record->hasDefinition() ? Record->getDefinition() : Record;
+    if (! Visited.insert(Definition->getCanonicalDecl()).second)
+        return;
+
+    for (auto const & Field : Definition->fields()) {
+        Result.push_back(Field);
+    }
+    if (Definition->hasDefinition()) {
+        for (auto const & Base : Definition->bases()) {
+            if (auto const * BaseType = Base.getType()->getAs<clang::RecordType>()) {
+                if (auto const * BaseDecl = clang::cast_or_null<clang::CXXRecordDecl>(BaseType->getDecl()->getDefinition())) {
+                    CollectFields(BaseDecl, Visited, Result);
+                }
+            }
+        }
+    }
+}
+
+// Traits of the on-disk hash table.
+class TableInfo {
+public:
+    typedef FunctionKey key_type;
+    typedef FunctionKey const & key_type_ref;
+    typedef FunctionKey internal_key_type;
+    typedef FunctionKey const & internal_key_ref;
+    typedef FunctionKey external_key_type;
+    typedef FunctionKey const & external_key_ref;
+    typedef FunctionRecord data_type;
+    typedef FunctionRecord const & data_type_ref;
+    typedef uint32_t hash_value_type;
+    typedef uint32_t offset_type;
+
+    static hash_value_type ComputeHash(key_type_ref Key) {
+        return static_cast<hash_value_type>(Key.Low);
+    }
+
+    static bool EqualKey(internal_key_ref Lhs, internal_key_ref Rhs) {
+        return (Lhs.High == Rhs.High) && (Lhs.Low == Rhs.Low);
+    }
+
+    static internal_key_type GetInternalKey(external_key_ref Key) {
+        return Key;
+    }
+
+    static external_key_type GetExternalKey(internal_key_ref Key) {
+        return Key;
+    }
+
+    static std::pair<offset_type, offset_type> EmitKeyDataLength(llvm::raw_ostream & Out, key_type_ref, data_type_ref Data) {
+        offset_type const KeyLength = 16;
+        offset_type const DataLength = 1 + 4 + 4 * Data.Effects.size();
+        llvm::support::endian::Writer Writer(Out, llvm::support::little);
+        Writer.write<offset_type>(KeyLength);
+        Writer.write<offset_type>(DataLength);
+        return std::make_pair(KeyLength, DataLength);
+    }
+
+    static void EmitKey(llvm::raw_ostream & Out, key_type_ref Key, offset_type) {
+        llvm::support::endian::Writer Writer(Out, llvm::support::little);
+        Writer.write<uint64_t>(Key.High);
+        Writer.write<uint64_t>(Key.Low);
+    }
+
+    static void EmitData(llvm::raw_ostream & Out, key_type_ref, data_type_ref Data, offset_type) {
+        llvm::support::endian::Writer Writer(Out, llvm::support::little);
+        Writer.write<uint8_t>(Data.Method);
+        Writer.write<uint32_t>(Data.Effects.size());
+        for (auto const Effect : Data.Effects) {
+            Writer.write<uint32_t>(Effect);
+        }
+    }
+
+    static std::pair<offset_type, offset_type> ReadKeyDataLength(unsigned char const * & Data) {
+        using namespace llvm::support;
+        offset_type const KeyLength = endian::readNext<offset_type, little, unaligned>(Data);
+        offset_type const DataLength = endian::readNext<offset_type, little, unaligned>(Data);
+        return std::make_pair(KeyLength, DataLength);
+    }
+
+    static internal_key_type ReadKey(unsigned char const * Data, offset_type) {
+        using namespace llvm::support;
+        FunctionKey Result;
+        Result.High = endian::readNext<uint64_t, little, unaligned>(Data);
+        Result.Low = endian::readNext<uint64_t, little, unaligned>(Data);
+        return Result;
+    }
+
+    static data_type ReadData(internal_key_ref, unsigned char const * Data, offset_type DataLength) {
+        using namespace llvm::support;
+        FunctionRecord Result;
+        Result.Method = FunctionRecord::None;
+        if (DataLength < 5)
+            return Result;
+
+        uint8_t const Method = endian::readNext<uint8_t, little, unaligned>(Data);
+        uint32_t const Count = endian::readNext<uint32_t, little, unaligned>(Data);
+        if ((Method > FunctionRecord::Static) || (DataLength != 5 + 4 * Count))
+            return Result;
+
+        Result.Method = static_cast<FunctionRecord::Verdict>(Method);
+        Result.Effects.reserve(Count);
+        for (uint32_t It = 0; It < Count; ++It) {
+            Result.Effects.push_back(endian::readNext<uint32_t, little, unaligned>(Data));
+        }
+        return Result;
+    }
+};
+
+
+std::string GetTablePath(std::string const & Directory, llvm::StringRef const MainFile, llvm::StringRef const Fingerprint) {
+    llvm::MD5 Hash;
+    Hash.update(MainFile);
+    Hash.update(llvm::StringRef("\0", 1));
+    Hash.update(Fingerprint);
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+
+    llvm::SmallString<256> File(Directory);
+    llvm::sys::path::append(File, Result.digest().str() + ".functions");
+    return File.str().str();
+}
+
+} // namespace anonymous
+
+
+class FunctionCache::Table {
+public:
+    Table(unsigned char const * const Buckets, unsigned char const * const Base)
+        : Index(llvm::OnDiskChainedHashTable<TableInfo>::Create(Buckets, Base))
+    { }
+
+    std::unique_ptr<llvm::OnDiskChainedHashTable<TableInfo>> const Index;
+};
+
+
+bool IsCacheableFunction(clang::FunctionDecl const * const F) {
+    if ((clang::FunctionDecl::TK_NonTemplate != F->getTemplatedKind()) || F->isDependentContext())
+        return false;
+    if (F->isImplicit() || F->getParentFunctionOrMethod())
+        return false;
+    // the ODR hash is not calculated for these
+    for (clang::DeclContext const * Context = F->getDeclContext(); Context; Context = Context->getParent()) {
+        if (clang::isa<clang::ClassTemplateSpecializationDecl>(Context))
+            return false;
+    }
+    return true;
+}
+
+std::vector<clang::DeclaratorDecl const *> GetFunctionUniverse(clang::FunctionDecl const * const F,
+                                                               clang::CXXRecordDecl const * const Record) {
+    std::vector<clang::DeclaratorDecl const *> Result;
+    for (auto const & It : F->decls()) {
+        if (auto const D = clang::dyn_cast<clang::VarDecl const>(It)) {
+            Result.push_back(D);
+        }
+    }
+    if (Record) {
+        llvm::DenseSet<clang::CXXRecordDecl const *> Visited;
+        CollectFields(Record, Visited, Result);
+    }
+    return Result;
+}
+
+FunctionKey GetFunctionKey(clang::FunctionDecl const * const F,
+                           std::vector<clang::DeclaratorDecl const *> const & Universe,
+                           Methods const * const MemberFunctions,
+                           llvm::StringRef const Fingerprint,
+                           ParameterSummaries const * const Summaries) {
+    llvm::MD5 Hash;
+    Hash.update(FormatVersion);
+    Hash.update(Fingerprint);
+    Hash.update(llvm::StringRef("\0", 1));
+    AddDeclaration(Hash, F);
+    {
+        uint32_t const ODRHash = const_cast<clang::FunctionDecl *>(F)->getODRHash();
+        Hash.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<uint8_t const *>(&ODRHash), sizeof(ODRHash)));
+    }
+    for (auto && Variable : Universe) {
+        AddDeclaration(Hash, Variable);
+    }
+    // the methods are hashed in a stable order
+    if (MemberFunctions) {
+        std::vector<std::string> Names;
+        for (auto && Method : *MemberFunctions) {
+            Names.push_back(Method->getQualifiedNameAsString() + ' '
+                + Method->getType().getCanonicalType().getAsString()
+                + (Method->isStatic() ? " static" : ""));
+        }
+        std::sort(Names.begin(), Names.end());
+        for (auto && Name : Names) {
+            Hash.update(Name);
+            Hash.update(llvm::StringRef("\0", 1));
+        }
+    }
+    {
+        ReferenceHasher Visitor(Hash, nullptr, Summaries);
+        Visitor.TraverseStmt(F->getBody());
+    }
+
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    return FunctionKey { Result.high(), Result.low() };
+}
+
+
+FunctionKey GetInstantiationKey(clang::FunctionDecl const * const Pattern,
+                                clang::FunctionDecl const * const Instantiation,
+                                std::vector<clang::DeclaratorDecl const *> const & Universe) {
+    llvm::MD5 Hash;
+    Hash.update(FormatVersion);
+    {
+        uint32_t const Location = Pattern->getLocation().getRawEncoding();
+        Hash.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<uint8_t const *>(&Location), sizeof(Location)));
+    }
+    {
+        ReferenceHasher Visitor(Hash, Instantiation);
+        for (auto && Parameter : Instantiation->parameters()) {
+            Visitor.Add(Parameter);
+        }
+        for (auto && Variable : Universe) {
+            Visitor.Add(Variable);
+        }
+        Visitor.TraverseStmt(Instantiation->getBody());
+    }
+
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    return FunctionKey { Result.high(), Result.low() };
+}
+
+
+FunctionCache::FunctionCache(std::string const & Directory, llvm::StringRef const MainFile, llvm::StringRef const Fingerprint)
+    : Directory(Directory)
+    , Path(GetTablePath(Directory, MainFile, Fingerprint))
+    , Buffer()
+    , Previous()
+    , Current()
+{
+    auto Loaded = llvm::MemoryBuffer::getFile(Path);
+    if (! Loaded)
+        return;
+
+    // header: magic and the offset of the buckets
+    llvm::StringRef const Content = Loaded.get()->getBuffer();
+    if (Content.size() < 8)
+        return;
+    auto const Base = reinterpret_cast<unsigned char const *>(Content.data());
+    using namespace llvm::support;
+    if (Magic != endian::read32le(Base))
+        return;
+    uint32_t const BucketOffset = endian::read32le(Base + 4);
+    if ((BucketOffset < 8) || (BucketOffset >= Content.size()) || (0 != BucketOffset % 4))
+        return;
+
+    Buffer = std::move(Loaded.get());
+    Previous = std::make_unique<Table>(Base + BucketOffset, Base);
+}
+
+FunctionCache::~FunctionCache() = default;
+
+bool FunctionCache::Lookup(FunctionKey const & Key, FunctionRecord & Result) const {
+    if (! Previous)
+        return false;
+
+    auto It = Previous->Index->find(Key);
+    if (Previous->Index->end() == It)
+        return false;
+
+    Result = *It;
+    return true;
+}
+
+void FunctionCache::Insert(FunctionKey const & Key, FunctionRecord const & Record) {
+    Current[Key] = Record;
+}
+
+void FunctionCache::Store() const {
+    llvm::SmallString<4096> Content;
+    {
+        llvm::raw_svector_ostream Stream(Content);
+        llvm::support::endian::Writer Writer(Stream, llvm::support::little);
+        Writer.write<uint32_t>(Magic);
+        Writer.write<uint32_t>(0);
+
+        llvm::OnDiskChainedHashTableGenerator<TableInfo> Generator;
+        for (auto && Entry : Current) {
+            Generator.insert(Entry.first, Entry.second);
+        }
+        uint32_t const BucketOffset = Generator.Emit(Stream);
+        llvm::support::endian::write32le(Content.data() + 4, BucketOffset);
+    }
+
+    if (llvm::sys::fs::create_directories(Directory))
+        return;
+
+    llvm::SmallString<256> Temporary;
+    int FD = -1;
+    if (llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%.tmp", FD, Temporary))
+        return;
+
+    {
+        llvm::raw_fd_ostream Stream(FD, true);
+        Stream << Content;
+        Stream.close();
+        if (Stream.has_error()) {
+            Stream.clear_error();
+            llvm::sys::fs::remove(Temporary);
+            return;
+        }
+    }
+    if (llvm::sys::fs::rename(Temporary, Path)) {
+        llvm::sys::fs::remove(Temporary);
+    }
+}
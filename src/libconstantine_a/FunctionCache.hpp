@@ -0,0 +1,106 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "DeclarationCollector.hpp"
+#include "ParameterSummaries.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <clang/AST/AST.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+
+// Fingerprint of a function. It covers everything the analysis of the
+// function depends on: the body (by its ODR hash), the signature, the
+// types of the referenced declarations and the parent record.
+struct FunctionKey {
+    uint64_t High;
+    uint64_t Low;
+
+    bool operator<(FunctionKey const & Other) const {
+        return (High < Other.High) || ((High == Other.High) && (Low < Other.Low));
+    }
+};
+
+// The contribution of a function to the module state. The declarations
+// are referred by their index in the function universe.
+struct FunctionRecord {
+    enum Verdict : uint8_t { None, Const, Static };
+
+    Verdict Method;
+    // index of the declaration shifted left, the lowest bit is set when
+    // the declaration was changed.
+    std::vector<uint32_t> Effects;
+};
+
+// Functions which are stable enough to be cached: not templates, not
+// instantiated from templates, and not local to another function.
+bool IsCacheableFunction(clang::FunctionDecl const *);
+
+// The declarations the analysis of a function can refer to, in a stable
+// order: the local variables (in declaration order), then the member
+// variables of the parent record and its bases (depth-first).
+std::vector<clang::DeclaratorDecl const *> GetFunctionUniverse(clang::FunctionDecl const *, clang::CXXRecordDecl const *);
+
+FunctionKey GetFunctionKey(clang::FunctionDecl const *,
+                           std::vector<clang::DeclaratorDecl const *> const & Universe,
+                           Methods const * MemberFunctions,
+                           llvm::StringRef Fingerprint,
+                           ParameterSummaries const * Summaries = nullptr);
+
+// Fingerprint of a template instantiation, which is the same for those
+// instantiations of the pattern which would give the same result. (Like
+// the instantiations of a class template, where the template argument is
+// not used by the method.) Valid only within the translation unit.
+FunctionKey GetInstantiationKey(clang::FunctionDecl const * Pattern,
+                                clang::FunctionDecl const * Instantiation,
+                                std::vector<clang::DeclaratorDecl const *> const & Universe);
+
+// Persistent store of the function records of a translation unit. It is
+// an on-disk hash table, which is read in place (memory mapped). The
+// records of the current run are written as a new table, which replaces
+// the old one atomically.
+class FunctionCache {
+public:
+    FunctionCache(std::string const & Directory, llvm::StringRef MainFile, llvm::StringRef Fingerprint);
+    ~FunctionCache();
+
+    FunctionCache(FunctionCache const &) = delete;
+    FunctionCache & operator=(FunctionCache const &) = delete;
+
+    bool Lookup(FunctionKey const & Key, FunctionRecord & Result) const;
+    void Insert(FunctionKey const & Key, FunctionRecord const & Record);
+    void Store() const;
+
+    class Table;
+
+private:
+    std::string const Directory;
+    std::string const Path;
+    std::unique_ptr<llvm::MemoryBuffer> Buffer;
+    std::unique_ptr<Table> Previous;
+    std::map<FunctionKey, FunctionRecord> Current;
+};
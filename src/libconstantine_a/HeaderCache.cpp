@@ -0,0 +1,338 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HeaderCache.hpp"
+
+#include <utility>
+
+#include <clang/Basic/IdentifierTable.h>
+#include <clang/Basic/TokenKinds.h>
+#include <clang/Lex/MacroInfo.h>
+#include <clang/Lex/Token.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace {
+
+// Change it when the format or the meaning of the entries change.
+char const * const FormatVersion = "constantine-header-cache-3";
+
+void Separate(llvm::MD5 & Hash) {
+    Hash.update(llvm::StringRef("\0", 1));
+}
+
+// The tokens of a definition are hashed by their spelling, so the same
+// definition from another translation unit gives the same digest.
+void HashToken(llvm::MD5 & Hash, clang::Token const & Token) {
+    if (clang::IdentifierInfo const * const Identifier = Token.getIdentifierInfo()) {
+        Hash.update(Identifier->getName());
+    } else if (Token.isLiteral() && Token.getLiteralData()) {
+        Hash.update(llvm::StringRef(Token.getLiteralData(), Token.getLength()));
+    } else if (char const * const Punctuator = clang::tok::getPunctuatorSpelling(Token.getKind())) {
+        Hash.update(Punctuator);
+    } else {
+        Hash.update(clang::tok::getTokenName(Token.getKind()));
+    }
+    Hash.update(Token.hasLeadingSpace() ? llvm::StringRef(" ") : llvm::StringRef());
+    Separate(Hash);
+}
+
+// The macro as the referring file sees it: the name and the definition,
+// or that it was not defined.
+llvm::MD5::MD5Result HashMacro(clang::IdentifierInfo const & Name, clang::MacroInfo const * const Macro) {
+    llvm::MD5 Hash;
+    Hash.update(Name.getName());
+    Separate(Hash);
+    if (nullptr == Macro) {
+        Hash.update("<undefined>");
+    } else if (Macro->isBuiltinMacro()) {
+        Hash.update("<builtin>");
+    } else {
+        Hash.update(Macro->isFunctionLike() ? "(" : "");
+        for (auto && Parameter : Macro->params()) {
+            Hash.update(Parameter->getName());
+            Separate(Hash);
+        }
+        Hash.update(Macro->isVariadic() ? "..." : "");
+        Separate(Hash);
+        for (auto && Token : Macro->tokens()) {
+            HashToken(Hash, Token);
+        }
+    }
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    return Result;
+}
+
+char const * GetKindName(Finding::Kind const Kind) {
+    switch (Kind) {
+        case Finding::Variable: return "variable";
+        case Finding::ConstFunction: return "const";
+        case Finding::StaticFunction: return "static";
+    }
+    return "";
+}
+
+bool ParseKind(llvm::StringRef const Name, Finding::Kind & Kind) {
+    for (auto const Candidate : { Finding::Variable, Finding::ConstFunction, Finding::StaticFunction }) {
+        if (Name == GetKindName(Candidate)) {
+            Kind = Candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One entry per line:
+//   finding <kind> <offset> <name>\t<usr>\t<function>
+//   field <changed> <field>
+bool ParseLine(llvm::StringRef const Line, HeaderFindings & Result) {
+    llvm::StringRef Tag, Rest;
+    std::tie(Tag, Rest) = Line.split(' ');
+    if (Tag == "finding") {
+        llvm::StringRef Kind, Offset, Name, USR, Function;
+        std::tie(Kind, Rest) = Rest.split(' ');
+        std::tie(Offset, Rest) = Rest.split(' ');
+        std::tie(Name, Rest) = Rest.split('\t');
+        std::tie(USR, Function) = Rest.split('\t');
+        HeaderFinding Entry = { Finding::Variable, 0, Name.str(), USR.str(), Function.str() };
+        if (! ParseKind(Kind, Entry.What) || Offset.getAsInteger(10, Entry.Offset) || Name.empty())
+            return false;
+        Result.Findings.push_back(std::move(Entry));
+        return true;
+    }
+    if (Tag == "field") {
+        llvm::StringRef Changed, Field;
+        std::tie(Changed, Field) = Rest.split(' ');
+        if ((Changed != "0" && Changed != "1") || Field.empty())
+            return false;
+        Result.FieldEffects.push_back(HeaderFieldEffect { Field.str(), Changed == "1" });
+        return true;
+    }
+    return false;
+}
+
+void Write(llvm::raw_ostream & Stream, HeaderFindings const & Findings) {
+    Stream << FormatVersion << '\n';
+    for (auto && Entry : Findings.Findings) {
+        Stream << "finding " << GetKindName(Entry.What) << ' ' << Entry.Offset << ' ' << Entry.Name
+               << '\t' << Entry.USR << '\t' << Entry.Function << '\n';
+    }
+    for (auto && Effect : Findings.FieldEffects) {
+        Stream << "field " << (Effect.Changed ? '1' : '0') << ' ' << Effect.Field << '\n';
+    }
+}
+
+} // namespace anonymous
+
+
+IncludeTracker::IncludeTracker(clang::SourceManager const & SM, std::shared_ptr<IncludeGraph> Graph)
+    : clang::PPCallbacks()
+    , Sources(SM)
+    , Graph(std::move(Graph))
+{ }
+
+void IncludeTracker::FileChanged(clang::SourceLocation const Location,
+                                 FileChangeReason const Reason,
+                                 clang::SrcMgr::CharacteristicKind,
+                                 clang::FileID) {
+    if (EnterFile != Reason)
+        return;
+
+    clang::FileID const File = Sources.getFileID(Location);
+    if (File.isInvalid())
+        return;
+
+    Graph->Files.push_back(File);
+    ++(Graph->Entered[Sources.getFileEntryForID(File)]);
+
+    clang::SourceLocation const IncludedFrom = Sources.getIncludeLoc(File);
+    if (IncludedFrom.isValid()) {
+        Graph->Includes[Sources.getFileID(IncludedFrom)].push_back(File);
+    }
+}
+
+
+void IncludeTracker::MacroExpands(clang::Token const & Name,
+                                  clang::MacroDefinition const & Definition,
+                                  clang::SourceRange,
+                                  clang::MacroArgs const *) {
+    Referred(Name, Definition);
+}
+
+void IncludeTracker::Defined(clang::Token const & Name,
+                             clang::MacroDefinition const & Definition,
+                             clang::SourceRange) {
+    Referred(Name, Definition);
+}
+
+void IncludeTracker::Ifdef(clang::SourceLocation,
+                           clang::Token const & Name,
+                           clang::MacroDefinition const & Definition) {
+    Referred(Name, Definition);
+}
+
+void IncludeTracker::Ifndef(clang::SourceLocation,
+                            clang::Token const & Name,
+                            clang::MacroDefinition const & Definition) {
+    Referred(Name, Definition);
+}
+
+// The macro is registered to the file where it was referred. (A macro
+// referred by the expansion of another macro is registered to the file
+// of the outermost expansion.)
+void IncludeTracker::Referred(clang::Token const & Name, clang::MacroDefinition const & Definition) {
+    clang::IdentifierInfo const * const Identifier = Name.getIdentifierInfo();
+    if (nullptr == Identifier)
+        return;
+
+    clang::FileID const File = Sources.getFileID(Sources.getExpansionLoc(Name.getLocation()));
+    if (File.isInvalid())
+        return;
+
+    clang::MacroInfo const * const Macro = Definition.getMacroInfo();
+    if (Registered.insert(std::make_pair(File, std::make_pair(Identifier, Macro))).second) {
+        Graph->Macros[File].push_back(HashMacro(*Identifier, Macro));
+    }
+}
+
+
+HeaderKeys::HeaderKeys(clang::SourceManager const & SM, IncludeGraph const & Graph, llvm::StringRef const Fingerprint)
+    : Sources(SM)
+    , Graph(Graph)
+    , Fingerprint(Fingerprint)
+    , Digests()
+{ }
+
+// The content and the macros of a file are hashed once, the keys of the
+// headers which include it take the digest only.
+llvm::MD5::MD5Result const & HeaderKeys::GetDigest(clang::FileID const File) {
+    auto const Found = Digests.find(File);
+    if (Digests.end() != Found)
+        return Found->second;
+
+    llvm::MD5 Hash;
+    {
+        bool Invalid = false;
+        llvm::StringRef const Content = Sources.getBufferData(File, &Invalid);
+        Hash.update(Invalid ? llvm::StringRef("<invalid>") : Content);
+        Separate(Hash);
+    }
+    auto const Macros = Graph.Macros.find(File);
+    if (Graph.Macros.end() != Macros) {
+        for (auto && Macro : Macros->second) {
+            Hash.update(Macro.Bytes);
+        }
+    }
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    return Digests[File] = Result;
+}
+
+std::string HeaderKeys::Get(clang::FileID const File) {
+    llvm::MD5 Hash;
+    Hash.update(FormatVersion);
+    Separate(Hash);
+    Hash.update(Fingerprint);
+    Separate(Hash);
+    // the header and the headers included by it
+    llvm::DenseSet<clang::FileID> Visited;
+    llvm::SmallVector<clang::FileID, 8> Works;
+    Works.push_back(File);
+    while (! Works.empty()) {
+        clang::FileID const Current = Works.pop_back_val();
+        if (! Visited.insert(Current).second)
+            continue;
+
+        Hash.update(GetDigest(Current).Bytes);
+        auto const It = Graph.Includes.find(Current);
+        if (Graph.Includes.end() != It) {
+            Works.append(It->second.rbegin(), It->second.rend());
+        }
+    }
+
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    return Result.digest().str().str();
+}
+
+
+HeaderCache::HeaderCache(std::string const & Directory)
+    : Directory(Directory)
+{ }
+
+std::string HeaderCache::GetPath(std::string const & Key) const {
+    llvm::SmallString<256> Result(Directory);
+    llvm::sys::path::append(Result, Key + ".findings");
+    return Result.str().str();
+}
+
+bool HeaderCache::Load(std::string const & Key, HeaderFindings & Result) const {
+    auto const Buffer = llvm::MemoryBuffer::getFile(GetPath(Key));
+    if (! Buffer)
+        return false;
+
+    llvm::StringRef Line, Rest = Buffer.get()->getBuffer();
+    std::tie(Line, Rest) = Rest.split('\n');
+    if (Line != FormatVersion)
+        return false;
+
+    HeaderFindings Findings;
+    while (! Rest.empty()) {
+        std::tie(Line, Rest) = Rest.split('\n');
+        if (! ParseLine(Line, Findings))
+            return false;
+    }
+    Result = std::move(Findings);
+    return true;
+}
+
+void HeaderCache::Store(std::string const & Key, HeaderFindings const & Findings) const {
+    if (llvm::sys::fs::create_directories(Directory))
+        return;
+
+    llvm::SmallString<256> Model(Directory);
+    llvm::sys::path::append(Model, Key + "-%%%%%%%%.tmp");
+    llvm::SmallString<256> Temporary;
+    int FD = -1;
+    if (llvm::sys::fs::createUniqueFile(Model, FD, Temporary))
+        return;
+
+    {
+        llvm::raw_fd_ostream Stream(FD, true);
+        Write(Stream, Findings);
+        Stream.close();
+        if (Stream.has_error()) {
+            Stream.clear_error();
+            llvm::sys::fs::remove(Temporary);
+            return;
+        }
+    }
+    // The rename is atomic. When more processes write the same entry,
+    // one of them wins, but all of them were writing the same content.
+    if (llvm::sys::fs::rename(Temporary, GetPath(Key))) {
+        llvm::sys::fs::remove(Temporary);
+    }
+}
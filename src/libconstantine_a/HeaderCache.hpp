@@ -0,0 +1,145 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "FindingSink.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <clang/Basic/SourceManager.h>
+#include <clang/Lex/PPCallbacks.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MD5.h>
+
+
+// The include tree of a translation unit. The cache key of a header
+// covers the content of the headers included by it too, and the macros
+// which those refer to.
+struct IncludeGraph {
+    // in the order they were entered
+    std::vector<clang::FileID> Files;
+    llvm::DenseMap<clang::FileID, std::vector<clang::FileID>> Includes;
+    llvm::DenseMap<clang::FileEntry const *, unsigned> Entered;
+    // the digests of the macros referred by the file, in the order of
+    // the first reference
+    llvm::DenseMap<clang::FileID, std::vector<llvm::MD5::MD5Result>> Macros;
+};
+
+// Preprocessor callback to build the include graph.
+class IncludeTracker : public clang::PPCallbacks {
+public:
+    IncludeTracker(clang::SourceManager const &, std::shared_ptr<IncludeGraph>);
+
+    IncludeTracker(IncludeTracker const &) = delete;
+    IncludeTracker & operator=(IncludeTracker const &) = delete;
+
+    void FileChanged(clang::SourceLocation, FileChangeReason, clang::SrcMgr::CharacteristicKind, clang::FileID) override;
+
+    void MacroExpands(clang::Token const &, clang::MacroDefinition const &, clang::SourceRange, clang::MacroArgs const *) override;
+    void Defined(clang::Token const &, clang::MacroDefinition const &, clang::SourceRange) override;
+    void Ifdef(clang::SourceLocation, clang::Token const &, clang::MacroDefinition const &) override;
+    void Ifndef(clang::SourceLocation, clang::Token const &, clang::MacroDefinition const &) override;
+
+private:
+    void Referred(clang::Token const &, clang::MacroDefinition const &);
+
+private:
+    clang::SourceManager const & Sources;
+    std::shared_ptr<IncludeGraph> Graph;
+    // the macro definitions (or the undefined names) already registered
+    // for a file
+    llvm::DenseSet<std::pair<clang::FileID, std::pair<clang::IdentifierInfo const *, clang::MacroInfo const *>>> Registered;
+};
+
+
+// A finding which belongs to a header, and does not depend on the
+// translation unit which includes it. The location is an offset in
+// the header.
+struct HeaderFinding {
+    Finding::Kind What;
+    unsigned Offset;
+    std::string Name;
+    std::string USR;
+    std::string Function;
+};
+
+// A member variable evaluation by a function of the header. Member
+// variables are shared by scopes from many files, therefore these are
+// not findings, but merged with the results of the other scopes.
+struct HeaderFieldEffect {
+    std::string Field;
+    bool Changed;
+};
+
+struct HeaderFindings {
+    std::vector<HeaderFinding> Findings;
+    std::vector<HeaderFieldEffect> FieldEffects;
+};
+
+// Calculates the cache keys of the headers. A key depends on the content
+// of the header (and the headers included by it), the macros those refer
+// to (with the definitions seen at the references), and the compiler
+// options. The rest of the translation unit is not part of it, so every
+// translation unit which includes an unchanged header (with the same
+// macros) shares its entry. The declarations which the header takes from
+// the files included before it are expected to be the same everywhere.
+class HeaderKeys {
+public:
+    HeaderKeys(clang::SourceManager const &, IncludeGraph const &, llvm::StringRef Fingerprint);
+
+    HeaderKeys(HeaderKeys const &) = delete;
+    HeaderKeys & operator=(HeaderKeys const &) = delete;
+
+    std::string Get(clang::FileID);
+
+private:
+    llvm::MD5::MD5Result const & GetDigest(clang::FileID);
+
+private:
+    clang::SourceManager const & Sources;
+    IncludeGraph const & Graph;
+    llvm::StringRef const Fingerprint;
+    llvm::DenseMap<clang::FileID, llvm::MD5::MD5Result> Digests;
+};
+
+// On-disk store of the header findings. Entries are written to a
+// temporary file first, then renamed, so concurrent compiler processes
+// never see partially written entries.
+class HeaderCache {
+public:
+    explicit HeaderCache(std::string const & Directory);
+
+    HeaderCache(HeaderCache const &) = delete;
+    HeaderCache & operator=(HeaderCache const &) = delete;
+
+    bool Load(std::string const & Key, HeaderFindings & Result) const;
+    void Store(std::string const & Key, HeaderFindings const & Findings) const;
+
+private:
+    std::string GetPath(std::string const & Key) const;
+
+private:
+    std::string const Directory;
+};
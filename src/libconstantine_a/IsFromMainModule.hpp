@@ -20,6 +20,8 @@
 #pragma once
 
 #include <clang/AST/AST.h>
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/DenseMap.h>
 
 
 inline
@@ -27,3 +29,47 @@ bool IsFromMainModule(clang::Decl const * const D) {
     auto const & SM = D->getASTContext().getSourceManager();
     return SM.isInMainFile(D->getLocation());
 }
+
+// Memoized variant of the check above, which answers for the whole file.
+// It is meant to filter declarations before analysis. Therefore it errs on
+// the safe side: files which have line directives to other files are
+// considered as main module. Optionally the user headers (non system
+// headers) are considered as part of the module too.
+class ModuleFilter {
+public:
+    ModuleFilter(clang::SourceManager const & SM, bool const WithHeaders)
+        : Sources(SM)
+        , WithHeaders(WithHeaders)
+        , Files()
+    { }
+
+    ModuleFilter(ModuleFilter const &) = delete;
+    ModuleFilter & operator=(ModuleFilter const &) = delete;
+
+    bool Contains(clang::Decl const * const D) {
+        auto const Location = D->getLocation();
+        if (Location.isInvalid())
+            return false;
+
+        return Contains(Sources.getFileID(Sources.getExpansionLoc(Location)));
+    }
+
+    bool Contains(clang::FileID const File) {
+        auto const It = Files.find(File);
+        if (Files.end() != It)
+            return It->second;
+
+        auto const Start = Sources.getLocForStartOfFile(File);
+        bool const Result = Sources.isInMainFile(Start)
+            || (WithHeaders
+                && (nullptr != Sources.getFileEntryForID(File))
+                && (! Sources.isInSystemHeader(Start)));
+        Files.insert(std::make_pair(File, Result));
+        return Result;
+    }
+
+private:
+    clang::SourceManager const & Sources;
+    bool const WithHeaders;
+    llvm::DenseMap<clang::FileID, bool> Files;
+};
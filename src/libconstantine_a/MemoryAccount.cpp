@@ -0,0 +1,141 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MemoryAccount.hpp"
+
+#include <llvm/Support/JSON.h>
+
+
+namespace {
+
+thread_local MemoryAccount * ActiveAccount = nullptr;
+thread_local MemoryPhase ActivePhase = MemoryPhase::Other;
+
+unsigned GetIndex(MemoryPhase const Which) {
+    return static_cast<unsigned>(Which);
+}
+
+char const * GetPhaseName(MemoryPhase const Which) {
+    switch (Which) {
+        case MemoryPhase::DeclarationCollector: return "declaration-collector";
+        case MemoryPhase::ScopeAnalysis: return "scope-analysis";
+        case MemoryPhase::State: return "state";
+        case MemoryPhase::Other: return "other";
+    }
+    return "";
+}
+
+MemoryPhase const AllPhases[] = {
+    MemoryPhase::DeclarationCollector,
+    MemoryPhase::ScopeAnalysis,
+    MemoryPhase::State,
+    MemoryPhase::Other
+};
+
+} // namespace anonymous
+
+
+MemoryAccount::MemoryAccount()
+    : Allocations()
+    , AllocatedBytes()
+    , LiveBytes(0)
+    , PeakLiveBytes(0)
+{
+    for (unsigned It = 0; It < PhaseCount; ++It) {
+        Allocations[It] = 0;
+        AllocatedBytes[It] = 0;
+    }
+}
+
+MemoryAccount::Counters MemoryAccount::Get(MemoryPhase const Which) const {
+    return Counters { Allocations[GetIndex(Which)].load(), AllocatedBytes[GetIndex(Which)].load() };
+}
+
+std::uint64_t MemoryAccount::GetPeakLiveBytes() const {
+    return static_cast<std::uint64_t>(PeakLiveBytes.load());
+}
+
+void MemoryAccount::Write(llvm::raw_ostream & OS, llvm::StringRef const File, MemoryReport const Format) const {
+    if (MemoryReport::Json == Format) {
+        llvm::json::OStream J(OS);
+        J.object([&] {
+            J.attribute("file", File);
+            J.attributeObject("phases", [&] {
+                for (auto const Which : AllPhases) {
+                    Counters const Current = Get(Which);
+                    J.attributeObject(GetPhaseName(Which), [&] {
+                        J.attribute("allocations", static_cast<int64_t>(Current.Allocations));
+                        J.attribute("allocated_bytes", static_cast<int64_t>(Current.AllocatedBytes));
+                    });
+                }
+            });
+            J.attribute("peak_live_bytes", static_cast<int64_t>(GetPeakLiveBytes()));
+        });
+        OS << '\n';
+    } else {
+        OS << "constantine: memory of " << File << ':';
+        for (auto const Which : AllPhases) {
+            Counters const Current = Get(Which);
+            OS << ' ' << GetPhaseName(Which) << ' ' << Current.Allocations
+               << " allocations " << Current.AllocatedBytes << " bytes,";
+        }
+        OS << " peak live " << GetPeakLiveBytes() << " bytes\n";
+    }
+}
+
+MemoryAccount * MemoryAccount::GetActive() {
+    return ActiveAccount;
+}
+
+void MemoryAccount::Grow(std::size_t const Before, std::size_t const After) {
+    unsigned const Index = GetIndex(ActivePhase);
+    Allocations[Index].fetch_add(1, std::memory_order_relaxed);
+    AllocatedBytes[Index].fetch_add(After, std::memory_order_relaxed);
+
+    std::int64_t const Live =
+        LiveBytes.fetch_add(static_cast<std::int64_t>(After - Before), std::memory_order_relaxed)
+        + static_cast<std::int64_t>(After - Before);
+    std::int64_t Peak = PeakLiveBytes.load(std::memory_order_relaxed);
+    while ((Live > Peak) && (! PeakLiveBytes.compare_exchange_weak(Peak, Live, std::memory_order_relaxed))) {
+    }
+}
+
+void MemoryAccount::Release(std::size_t const Bytes) {
+    LiveBytes.fetch_sub(static_cast<std::int64_t>(Bytes), std::memory_order_relaxed);
+}
+
+MemoryAccount::Activation::Activation(MemoryAccount * const Account)
+    : Previous(ActiveAccount)
+{
+    ActiveAccount = Account;
+}
+
+MemoryAccount::Activation::~Activation() {
+    ActiveAccount = Previous;
+}
+
+MemoryAccount::Phase::Phase(MemoryPhase const Which)
+    : Previous(ActivePhase)
+{
+    ActivePhase = Which;
+}
+
+MemoryAccount::Phase::~Phase() {
+    ActivePhase = Previous;
+}
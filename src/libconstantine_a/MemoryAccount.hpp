@@ -0,0 +1,156 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+// The phases of the analysis, which allocations are accounted separately.
+enum class MemoryPhase { DeclarationCollector, ScopeAnalysis, State, Other };
+
+// Where the memory report of a translation unit goes.
+enum class MemoryReport { None, Stderr, Json };
+
+// Accounting of the heap memory of the analysis containers. The containers
+// report the change of their heap capacity (with HeapUsage), a growth is
+// counted as one allocation of the new capacity. So, the numbers are the
+// allocations of the analysis containers, not the ones made by Clang.
+//
+// The account is active on a thread while an activation of it exists.
+// The allocations are counted to the phase, which was set on the thread.
+// The counters are atomic, the workers of a translation unit share one
+// account.
+class MemoryAccount {
+public:
+    struct Counters {
+        std::uint64_t Allocations;
+        std::uint64_t AllocatedBytes;
+    };
+
+    MemoryAccount();
+
+    MemoryAccount(MemoryAccount const &) = delete;
+    MemoryAccount & operator=(MemoryAccount const &) = delete;
+
+    Counters Get(MemoryPhase) const;
+    std::uint64_t GetPeakLiveBytes() const;
+
+    // Writes the counters as text (one line) or as a JSON object.
+    void Write(llvm::raw_ostream &, llvm::StringRef File, MemoryReport) const;
+
+    class Activation {
+    public:
+        explicit Activation(MemoryAccount *);
+        ~Activation();
+
+        Activation(Activation const &) = delete;
+        Activation & operator=(Activation const &) = delete;
+
+    private:
+        MemoryAccount * const Previous;
+    };
+
+    class Phase {
+    public:
+        explicit Phase(MemoryPhase);
+        ~Phase();
+
+        Phase(Phase const &) = delete;
+        Phase & operator=(Phase const &) = delete;
+
+    private:
+        MemoryPhase const Previous;
+    };
+
+    static MemoryAccount * GetActive();
+
+private:
+    friend class HeapUsage;
+    void Grow(std::size_t Before, std::size_t After);
+    void Release(std::size_t Bytes);
+
+private:
+    static constexpr unsigned PhaseCount = 4;
+    std::atomic<std::uint64_t> Allocations[PhaseCount];
+    std::atomic<std::uint64_t> AllocatedBytes[PhaseCount];
+    std::atomic<std::int64_t> LiveBytes;
+    std::atomic<std::int64_t> PeakLiveBytes;
+};
+
+// The heap bytes of a container, which were reported to the active
+// account. The container calls Update after its capacity might changed.
+// (Nothing is reported, while no account is active. But the bytes are
+// kept, so a later growth is measured from the actual capacity.)
+class HeapUsage {
+public:
+    HeapUsage()
+        : Bytes(0)
+    { }
+
+    // The copy has its own heap, the container reports it.
+    HeapUsage(HeapUsage const &)
+        : Bytes(0)
+    { }
+
+    HeapUsage(HeapUsage && Other)
+        : Bytes(Other.Bytes)
+    {
+        Other.Bytes = 0;
+    }
+
+    HeapUsage & operator=(HeapUsage const &) {
+        return *this;
+    }
+
+    HeapUsage & operator=(HeapUsage && Other) {
+        if (this != &Other) {
+            Update(0);
+            Bytes = Other.Bytes;
+            Other.Bytes = 0;
+        }
+        return *this;
+    }
+
+    ~HeapUsage() {
+        Update(0);
+    }
+
+    void Update(std::size_t const Current) {
+        if (Current == Bytes)
+            return;
+
+        if (MemoryAccount * const Account = MemoryAccount::GetActive()) {
+            if (Current > Bytes) {
+                Account->Grow(Bytes, Current);
+            } else {
+                Account->Release(Bytes - Current);
+            }
+        }
+        Bytes = Current;
+    }
+
+private:
+    std::size_t Bytes;
+};
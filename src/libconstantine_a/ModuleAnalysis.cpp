@@ -21,27 +21,67 @@
 
 #include "DeclarationCollector.hpp"
 #include "ScopeAnalysis.hpp"
-#include "IsCXXThisExpr.hpp"
 #include "IsFromMainModule.hpp"
+#include "HeaderCache.hpp"
+#include "FunctionCache.hpp"
+#include "FindingSink.hpp"
+#include "ParameterSummaries.hpp"
+#include "MemoryAccount.hpp"
+#include "FieldFacts.hpp"
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <clang/AST/AST.h>
+#include <clang/AST/DeclGroup.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Basic/Diagnostic.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
 
 
 namespace {
 
-// Report function for pseudo constness analysis.
-template <unsigned N>
-void EmitWarningMessage(clang::DiagnosticsEngine & DE, char const (&Message)[N], clang::DeclaratorDecl const * const V) {
-    unsigned const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Warning, Message);
-    clang::DiagnosticBuilder const DB = DE.Report(V->getBeginLoc(), Id);
-    DB << V->getNameAsString();
-    DB.setForceEmit();
-}
+// Effects of a function on the member variables. Recorded for the header
+// cache, because the member variables are shared by many functions.
+typedef std::vector<std::pair<clang::FieldDecl const *, bool>> FieldEffects;
+
+// Evaluations of the variables by a function: the variable and whether it
+// was changed or not.
+typedef std::vector<std::pair<clang::DeclaratorDecl const *, bool>> Evaluations;
+
+// The contribution of a function to the module state. It is either the
+// result of the analysis, or replayed from the function cache.
+struct Contribution {
+    Evaluations Variables;
+    FunctionRecord::Verdict Method;
+    HeapUsage Heap;
+
+    // The evaluations are counted to the module state, which those are
+    // applied to.
+    void Account() {
+        MemoryAccount::Phase const Accounting(MemoryPhase::State);
+        Heap.Update(Variables.capacity() * sizeof(Evaluations::value_type));
+    }
+};
+
+// Detail of the time trace entries. The function name is computed only
+// when the tracing is enabled.
+struct TraceDetail {
+    clang::FunctionDecl const * Function;
+
+    std::string operator()() const {
+        return Function->getQualifiedNameAsString();
+    }
+};
 
 bool CanThisMethodSignatureChange(clang::CXXMethodDecl const * const F) {
     return
@@ -54,36 +94,148 @@ bool CanThisMethodSignatureChange(clang::CXXMethodDecl const * const F) {
 }
 
 
+// The instantiations of a function template, or of a method of a class
+// template, which have body.
+std::vector<clang::FunctionDecl const *> GetInstantiations(clang::FunctionDecl const * const F) {
+    std::vector<clang::FunctionDecl const *> Result;
+    auto const Add = [F, &Result](clang::FunctionDecl const * const Candidate) {
+        clang::FunctionDecl const * const Pattern = Candidate->getTemplateInstantiationPattern();
+        if (Pattern && (Pattern->getCanonicalDecl() == F->getCanonicalDecl()) && Candidate->doesThisDeclarationHaveABody()) {
+            Result.push_back(Candidate);
+        }
+    };
+    if (auto const Template = F->getDescribedFunctionTemplate()) {
+        for (auto && Specialization: Template->specializations()) {
+            Add(Specialization);
+        }
+    } else if (auto const Method = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+        clang::CXXRecordDecl const * const Parent = Method->getParent();
+        auto const Partial = clang::dyn_cast<clang::ClassTemplatePartialSpecializationDecl const>(Parent);
+        clang::ClassTemplateDecl const * const Template =
+            (Partial) ? Partial->getSpecializedTemplate() : Parent->getDescribedClassTemplate();
+        if (Template) {
+            for (auto && Specialization: Template->specializations()) {
+                for (auto && D: Specialization->decls()) {
+                    if (auto const Candidate = clang::dyn_cast<clang::FunctionDecl const>(D)) {
+                        Add(Candidate);
+                    }
+                }
+            }
+        }
+    }
+    return Result;
+}
+
+// Maps the declarations of an instantiation to the declarations of the
+// pattern. The instantiated declarations have the same location as the
+// pattern declarations they were instantiated from.
+class PatternLocals {
+public:
+    explicit PatternLocals(clang::FunctionDecl const * const Pattern)
+        : Locals()
+    {
+        for (auto && Parameter: Pattern->parameters()) {
+            Locals.insert(std::make_pair(Parameter->getLocation().getRawEncoding(), Parameter));
+        }
+        for (auto && Variable: GetFunctionUniverse(Pattern, nullptr)) {
+            Locals.insert(std::make_pair(Variable->getLocation().getRawEncoding(), Variable));
+        }
+    }
+
+    PatternLocals(PatternLocals const &) = delete;
+    PatternLocals & operator=(PatternLocals const &) = delete;
+
+    // Returns null when the pattern declaration is not found.
+    clang::DeclaratorDecl const * GetPattern(clang::DeclaratorDecl const * const D) const {
+        auto const Function = clang::dyn_cast_or_null<clang::FunctionDecl const>(D->getParentFunctionOrMethod());
+        if (Function && Function->isTemplateInstantiation()) {
+            return Locals.lookup(D->getLocation().getRawEncoding());
+        }
+        if (auto const Field = clang::dyn_cast<clang::FieldDecl const>(D)) {
+            auto const Record = clang::dyn_cast<clang::CXXRecordDecl const>(Field->getParent());
+            clang::CXXRecordDecl const * const Pattern = (Record) ? Record->getTemplateInstantiationPattern() : nullptr;
+            if (Pattern && (Pattern != Record)) {
+                for (auto && Candidate: Pattern->fields()) {
+                    if (Candidate->getLocation() == Field->getLocation())
+                        return Candidate;
+                }
+                return nullptr;
+            }
+        }
+        return D;
+    }
+
+private:
+    llvm::DenseMap<unsigned, clang::DeclaratorDecl const *> Locals;
+};
+
+
 // Pseudo constness analysis detects what variable can be declare as const.
 // This analysis runs through multiple scopes. We need to store the state of
 // the ongoing analysis. Once the variable was changed can't be const.
 class PseudoConstnessAnalysisState {
 public:
+    // These sets grow with the whole module, hashing scales better than
+    // the sorted vector of the per scope sets.
+    typedef llvm::DenseSet<clang::DeclaratorDecl const *> VariableSet;
+
     PseudoConstnessAnalysisState()
         : Candidates()
         , Changed()
+        , Heap()
     { }
 
     PseudoConstnessAnalysisState(PseudoConstnessAnalysisState const &) = delete;
     PseudoConstnessAnalysisState & operator=(PseudoConstnessAnalysisState const &) = delete;
 
 
-    void Eval(ScopeAnalysis const & Analysis, clang::DeclaratorDecl const * const V) {
-        if (Analysis.WasChanged(V)) {
-            for (auto && Variable: GetReferredVariables(V)) {
-                RegisterChange(Variable);
-            }
-        } else if (Changed.end() == Changed.find(V)) {
-            if (! IsConst(*V)) {
-                Candidates.insert(V);
+    // The evaluation is not registered right away, but collected. So, it
+    // can be stored in the cache too.
+    static void Eval(ScopeAnalysis const & Analysis, AliasGraph & Aliases, Variables const & Candidates, Evaluations & Result) {
+        llvm::SmallVector<clang::DeclaratorDecl const *, 16> Changed;
+        for (auto && V: Candidates) {
+            if (Analysis.WasChanged(V)) {
+                Changed.push_back(V);
+            } else {
+                Result.push_back(std::make_pair(V, false));
             }
         }
+        Aliases.ForEachReferred(Changed, [&Result](clang::DeclaratorDecl const * const Variable) {
+            Result.push_back(std::make_pair(Variable, true));
+        });
+    }
+
+    void Apply(Evaluations const & Results) {
+        for (auto && Result: Results) {
+            Replay(Result.first, Result.second);
+        }
+    }
+
+    // Apply an evaluation, which was made by an other translation unit.
+    void Replay(clang::DeclaratorDecl const * const V, bool const WasChanged) {
+        MemoryAccount::Phase const Accounting(MemoryPhase::State);
+        if (WasChanged) {
+            RegisterChange(V);
+        } else {
+            RegisterUsage(V);
+        }
+        Heap.Update(Candidates.getMemorySize() + Changed.getMemorySize());
+    }
+
+    VariableSet const & GetCandidates() const {
+        return Candidates;
+    }
+
+    VariableSet const & GetChanged() const {
+        return Changed;
     }
 
-    void GenerateReports(clang::DiagnosticsEngine & DE) const {
+    // The member variables are not reported when their verdict is left to
+    // the whole program merge.
+    void GenerateReports(std::vector<Finding> & Findings, ModuleFilter & Filter, bool const WithFields) const {
         for (auto && Variable: Candidates) {
-            if (IsFromMainModule(Variable)) {
-                EmitWarningMessage(DE, "variable '%0' could be declared as const", Variable);
+            if (Filter.Contains(Variable) && (WithFields || (! clang::isa<clang::FieldDecl>(Variable)))) {
+                Findings.push_back(MakeFinding(Finding::Variable, Variable));
             }
         }
     }
@@ -98,15 +250,242 @@ private:
         Changed.insert(V);
     }
 
+    void RegisterUsage(clang::DeclaratorDecl const * const V) {
+        if ((0 == Changed.count(V)) && (! IsConst(*V))) {
+            Candidates.insert(V);
+        }
+    }
+
+private:
+    VariableSet Candidates;
+    VariableSet Changed;
+    HeapUsage Heap;
+};
+
+
+// Connects a function to the function cache: calculates the key, and
+// translates the contribution of the function from/to the cache record.
+class FunctionCacheEntry {
+public:
+    FunctionCacheEntry(FunctionCache * const Cache,
+                       clang::FunctionDecl const * const F,
+                       clang::CXXRecordDecl const * const Record,
+                       Methods const * const MemberFunctions,
+                       llvm::StringRef const Fingerprint,
+                       ParameterSummaries const * const Summaries)
+        : Cache((Cache && IsCacheableFunction(F)) ? Cache : nullptr)
+        , Universe()
+        , Key()
+    {
+        if (this->Cache) {
+            Universe = GetFunctionUniverse(F, Record);
+            Key = GetFunctionKey(F, Universe, MemberFunctions, Fingerprint, Summaries);
+        }
+    }
+
+    FunctionCacheEntry(FunctionCacheEntry const &) = delete;
+    FunctionCacheEntry & operator=(FunctionCacheEntry const &) = delete;
+
+    bool Load(Contribution & Result) const {
+        FunctionRecord Record;
+        if ((nullptr == Cache) || (! Cache->Lookup(Key, Record)))
+            return false;
+
+        Contribution Loaded = { Evaluations(), Record.Method };
+        for (auto const Effect: Record.Effects) {
+            auto const Index = Effect >> 1;
+            if (Index >= Universe.size())
+                return false;
+            Loaded.Variables.push_back(std::make_pair(Universe[Index], (0 != (Effect & 1))));
+        }
+        Result = std::move(Loaded);
+        return true;
+    }
+
+    // Contributions which refer to declarations outside of the universe
+    // are not stored. (Loaded contributions are stored again, to keep
+    // those for the next run.)
+    void Store(Contribution const & Result) const {
+        if (nullptr == Cache)
+            return;
+
+        llvm::DenseMap<clang::DeclaratorDecl const *, uint32_t> Indexes;
+        for (uint32_t Index = 0; Index < Universe.size(); ++Index) {
+            Indexes.insert(std::make_pair(Universe[Index], Index));
+        }
+        FunctionRecord Record = { Result.Method, std::vector<uint32_t>() };
+        for (auto && Variable: Result.Variables) {
+            auto const It = Indexes.find(Variable.first);
+            if (Indexes.end() == It)
+                return;
+            Record.Effects.push_back((It->second << 1) | (Variable.second ? 1 : 0));
+        }
+        Cache->Insert(Key, Record);
+    }
+
 private:
-    Variables Candidates;
-    Variables Changed;
+    FunctionCache * const Cache;
+    std::vector<clang::DeclaratorDecl const *> Universe;
+    FunctionKey Key;
+};
+
+// The analysis of a function, which was not committed to the module state
+// (and to the function cache) yet.
+struct Job {
+    clang::FunctionDecl const * Function;
+    std::unique_ptr<FunctionCacheEntry> Entry;
+    Contribution Result;
 };
 
 
 class PseudoConstnessAnalysis
     : public clang::RecursiveASTVisitor<PseudoConstnessAnalysis> {
 public:
+    PseudoConstnessAnalysis(clang::SourceManager const & SM,
+                            bool const WithHeaders,
+                            bool const WithInstantiations,
+                            unsigned const Workers,
+                            FunctionCache * const Functions,
+                            llvm::StringRef const Fingerprint)
+        : clang::RecursiveASTVisitor<PseudoConstnessAnalysis>()
+        , Sources(SM)
+        , Functions(Functions)
+        , Fingerprint(Fingerprint)
+        , WithInstantiations(WithInstantiations)
+        , Workers(Workers)
+        , Filter(SM, WithHeaders)
+        , Records()
+        , State()
+        , ConstCandidates()
+        , StaticCandidates()
+        , CandidatesHeap()
+        , Replayed()
+        , Recorded()
+        , Fields()
+        , Instantiations()
+        , Summaries()
+        , Pending()
+        , Patterns()
+        , Traversed()
+        , FirstLocal()
+        , Visible()
+    { }
+
+    PseudoConstnessAnalysis(PseudoConstnessAnalysis const &) = delete;
+    PseudoConstnessAnalysis & operator=(PseudoConstnessAnalysis const &) = delete;
+
+    // Declarations from other files than the main file are not traversed.
+    // The results of those would not be reported anyway. (Except the
+    // declarations which might change the main file classes.)
+    bool TraverseDecl(clang::Decl * const D) {
+        if (D && (! clang::isa<clang::TranslationUnitDecl>(D))) {
+            if (! Filter.Contains(D)) {
+                return TraverseOtherFileDecl(D);
+            }
+            if (FirstLocal.isInvalid()) {
+                FirstLocal = Sources.getExpansionLoc(D->getLocation());
+            }
+        }
+        if (D && IsReplayed(D))
+            return true;
+        if (D && Traversed.count(D))
+            return true;
+
+        return clang::RecursiveASTVisitor<PseudoConstnessAnalysis>::TraverseDecl(D);
+    }
+
+    // Only the declarations which were parsed in this translation unit are
+    // traversed. The declarations of a precompiled header (or a module)
+    // are not loaded by the traversal, only on demand, when a local body
+    // refers to them.
+    void TraverseLocalDecls(clang::TranslationUnitDecl * const Unit) {
+        for (auto const D : Unit->noload_decls()) {
+            TraverseDecl(D);
+        }
+    }
+
+    // The streaming analysis gets the declarations as the parser completes
+    // those. A method of a main file class, which is defined later in
+    // another file, was not found by VisitCXXRecordDecl, it is traversed
+    // here.
+    void TraverseTopLevelDecl(clang::Decl * const D) {
+        auto const M = clang::dyn_cast<clang::CXXMethodDecl>(D);
+        if (M && M->isThisDeclarationADefinition() && M->isOutOfLine()
+              && (! Filter.Contains(M)) && Filter.Contains(M->getParent()) && (! IsReplayed(M))
+              && Traversed.insert(M).second) {
+            clang::RecursiveASTVisitor<PseudoConstnessAnalysis>::TraverseDecl(M);
+        } else {
+            TraverseDecl(D);
+        }
+    }
+
+    // A function of another file (eg.: of an included implementation
+    // file) might change the member variables of a main file class, when
+    // that file sees the main file declarations. Those files are traversed
+    // entirely. (The methods of main file classes are found by
+    // VisitCXXRecordDecl.) The system headers and the files which were
+    // entered before the first main file declaration are skipped.
+    bool TraverseOtherFileDecl(clang::Decl * const D) {
+        if (! SeesLocalDecls(D))
+            return true;
+
+        if (clang::isa<clang::NamespaceDecl>(D) || clang::isa<clang::LinkageSpecDecl>(D)) {
+            for (auto const Nested : clang::cast<clang::DeclContext>(D)->noload_decls()) {
+                TraverseDecl(Nested);
+            }
+            return true;
+        }
+        if (IsReplayed(D) || Traversed.count(D))
+            return true;
+
+        return clang::RecursiveASTVisitor<PseudoConstnessAnalysis>::TraverseDecl(D);
+    }
+
+    // The answer is memoized per file.
+    bool SeesLocalDecls(clang::Decl const * const D) {
+        if (FirstLocal.isInvalid())
+            return false;
+
+        clang::SourceLocation const Location = Sources.getExpansionLoc(D->getLocation());
+        if (Location.isInvalid())
+            return false;
+
+        clang::FileID const File = Sources.getFileID(Location);
+        auto It = Visible.find(File);
+        if (Visible.end() == It) {
+            bool const Result =
+                (! Sources.isInSystemHeader(Location))
+                && Sources.isBeforeInTranslationUnit(FirstLocal, Sources.getLocForStartOfFile(File));
+            It = Visible.insert(std::make_pair(File, Result)).first;
+        }
+        return It->second;
+    }
+
+    // The inline methods are traversed as soon as their body was parsed,
+    // and not again with their class.
+    void TraverseInlineFunction(clang::FunctionDecl * const F) {
+        TraverseDecl(F);
+        Traversed.insert(F);
+    }
+
+    // Methods of a main file class might be defined in another file (eg.:
+    // in an included implementation file). Those are still traversed,
+    // because they can change the member variables of the class.
+    bool VisitCXXRecordDecl(clang::CXXRecordDecl const * const R) {
+        if (! (R->isThisDeclarationADefinition() && Filter.Contains(R)))
+            return true;
+
+        for (auto const & Method : R->methods()) {
+            clang::FunctionDecl const * const Definition = Method->getDefinition();
+            if (Definition && (! Filter.Contains(Definition)) && (! IsReplayed(Definition))
+                           && Traversed.insert(Definition).second) {
+                clang::RecursiveASTVisitor<PseudoConstnessAnalysis>::TraverseDecl(
+                    const_cast<clang::FunctionDecl *>(Definition));
+            }
+        }
+        return true;
+    }
+
     // Implement function declaration visitor, which visit functions only once.
     // The traversal algorithm is calling all methods, which is not desired.
     // In case of a CXXMethodDecl, it was calling the VisitFunctionDecl and
@@ -115,57 +494,197 @@ public:
         if (! (F->isThisDeclarationADefinition()))
             return true;
 
-        if (auto const D = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
-            OnCXXMethodDecl(D);
+        // the instantiations are complete at the end of the translation unit.
+        if (WithInstantiations && F->isTemplated()) {
+            Patterns.push_back(F);
+            return true;
+        }
+
+        if (Workers > 1) {
+            Pending.push_back(F);
         } else {
-            OnFunctionDecl(F);
+            Commit(Analyse(F, Records));
         }
         return true;
     }
 
-    void OnFunctionDecl(clang::FunctionDecl const * const F) {
-        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-        for (auto && Variable: GetVariablesFromContext(F)) {
-            State.Eval(Analysis, Variable);
+    // Collect the member variables of the replayed headers, because the
+    // cached results refer to those.
+    bool VisitFieldDecl(clang::FieldDecl const * const F) {
+        if (! Replayed.empty()) {
+            Fields.insert(std::make_pair(GetFieldKey(F), F));
+        }
+        return true;
+    }
+
+    // The analysis of a function reads the AST and writes only the given
+    // record summaries. So, it can run on a worker thread, while the result
+    // is committed on the main thread.
+    Job Analyse(clang::FunctionDecl const * const F, RecordSummaryCache & RecordCache) const {
+        if (auto const D = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+            return OnCXXMethodDecl(D, RecordCache);
+        }
+        return OnFunctionDecl(F);
+    }
+
+    Job OnFunctionDecl(clang::FunctionDecl const * const F) const {
+        Job Result = { F, std::make_unique<FunctionCacheEntry>(Functions, F, nullptr, nullptr, Fingerprint, Summaries.get()), Contribution { Evaluations(), FunctionRecord::None } };
+        if (! Result.Entry->Load(Result.Result)) {
+            Variables Locals;
+            {
+                llvm::TimeTraceScope const Trace("ConstantineCollectDeclarations", TraceDetail { F });
+                MemoryAccount::Phase const Accounting(MemoryPhase::DeclarationCollector);
+                Locals = GetVariablesFromContext(F);
+            }
+            ScopeAnalysis const & Analysis = AnalyseBody(F);
+            AliasGraph Aliases(F);
+            PseudoConstnessAnalysisState::Eval(Analysis, Aliases, Locals, Result.Result.Variables);
         }
+        Result.Result.Account();
+        return Result;
     }
 
-    void OnCXXMethodDecl(clang::CXXMethodDecl const * const F) {
+    Job OnCXXMethodDecl(clang::CXXMethodDecl const * const F, RecordSummaryCache & RecordCache) const {
         clang::CXXRecordDecl const * const Parent = F->getParent();
         clang::CXXRecordDecl const * const RecordDecl =
             Parent->hasDefinition() ? Parent->getDefinition() : Parent->getCanonicalDecl();
-        Variables const MemberVariables = GetMemberVariablesAndReferences(RecordDecl, F);
-        // check variables first,
-        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-        for (auto && Variable: GetVariablesFromContext(F, (!CanThisMethodSignatureChange(F)))) {
-            State.Eval(Analysis, Variable);
+        // the member variables are shared by all methods of the class,
+        // only the local references to them are collected per method.
+        Variables Locals;
+        Variables MemberReferences;
+        AliasGraph Aliases(F);
+        RecordSummary const & Record = CollectDeclarations(F, RecordDecl, RecordCache, Aliases, Locals, MemberReferences);
+        Job Result = { F, std::make_unique<FunctionCacheEntry>(Functions, F, RecordDecl, &Record.MemberFunctions, Fingerprint, Summaries.get()), Contribution { Evaluations(), FunctionRecord::None } };
+        if (! Result.Entry->Load(Result.Result)) {
+            // check variables first,
+            ScopeAnalysis const & Analysis = AnalyseBody(F);
+            PseudoConstnessAnalysisState::Eval(Analysis, Aliases, Locals, Result.Result.Variables);
+            PseudoConstnessAnalysisState::Eval(Analysis, Aliases, Record.MemberVariables, Result.Result.Variables);
+            PseudoConstnessAnalysisState::Eval(Analysis, Aliases, MemberReferences, Result.Result.Variables);
+            // then check the method itself.
+            Result.Result.Method = EvalMethod(F, Record, MemberReferences, Analysis);
+        }
+        Result.Result.Account();
+        return Result;
+    }
+
+    void Commit(Job const & Done) {
+        Done.Entry->Store(Done.Result);
+        Apply(Done.Function, Done.Result);
+    }
+
+    // Finish the analysis of the functions, which were collected by the
+    // traversal.
+    void Finish() {
+        for (auto && F: Patterns) {
+            if (! OnTemplatePattern(F)) {
+                Commit(Analyse(F, Records));
+            }
+        }
+        Patterns.clear();
+        AnalysePending();
+    }
+
+    // Analyse the collected functions on worker threads. The functions are
+    // split into chunks (in the order of the traversal), each chunk has its
+    // own record summaries. The results are committed in the same order as
+    // the serial analysis would do.
+    void AnalysePending() {
+        if (Pending.empty())
+            return;
+
+        llvm::TimeTraceScope const Trace("ConstantineParallelAnalysis");
+        std::vector<Job> Jobs(Pending.size());
+        {
+            std::size_t const Chunks = std::min<std::size_t>(Pending.size(), Workers * 4);
+            std::size_t const ChunkSize = (Pending.size() + Chunks - 1) / Chunks;
+            MemoryAccount * const Account = MemoryAccount::GetActive();
+            llvm::ThreadPool Pool(llvm::hardware_concurrency(Workers));
+            for (std::size_t Begin = 0; Begin < Pending.size(); Begin += ChunkSize) {
+                std::size_t const End = std::min(Begin + ChunkSize, Pending.size());
+                Pool.async([this, Begin, End, Account, &Jobs]() {
+                    MemoryAccount::Activation const Accounting(Account);
+                    RecordSummaryCache RecordCache;
+                    for (std::size_t It = Begin; It < End; ++It) {
+                        Jobs[It] = Analyse(Pending[It], RecordCache);
+                    }
+                });
+            }
+            Pool.wait();
         }
-        for (auto && Variable: MemberVariables) {
-            State.Eval(Analysis, Variable);
+        for (auto && Done: Jobs) {
+            Commit(Done);
         }
-        // then check the method itself.
+        Pending.clear();
+    }
+
+    // The pattern of a template is analysed through its instantiations,
+    // because the mutations through dependent expressions are visible only
+    // in those. The verdicts are merged to the pattern: a variable can be
+    // const only if no instantiation changes it, and the method verdict is
+    // the weakest of the instantiations. Instantiations which would give
+    // the same result are analysed only once. Returns false when there is
+    // no instantiation to analyse.
+    bool OnTemplatePattern(clang::FunctionDecl const * const F) {
+        std::vector<clang::FunctionDecl const *> const Specializations = GetInstantiations(F);
+        if (Specializations.empty())
+            return false;
+
+        llvm::TimeTraceScope const Trace("ConstantineInstantiations", TraceDetail { F });
+        PatternLocals const Locals(F);
+        Contribution Merged = { Evaluations(), FunctionRecord::Static };
+        for (auto && Specialization: Specializations) {
+            auto const Method = clang::dyn_cast<clang::CXXMethodDecl const>(Specialization);
+            clang::CXXRecordDecl const * const Record = (Method) ? Method->getParent() : nullptr;
+            FunctionKey const Key = GetInstantiationKey(F, Specialization, GetFunctionUniverse(Specialization, Record));
+            auto It = Instantiations.find(Key);
+            if (Instantiations.end() == It) {
+                Job const Done = Analyse(Specialization, Records);
+                Done.Entry->Store(Done.Result);
+                Contribution const & Result = Done.Result;
+                Contribution Translated = { Evaluations(), Result.Method };
+                for (auto && Variable: Result.Variables) {
+                    if (auto const Pattern = Locals.GetPattern(Variable.first)) {
+                        Translated.Variables.push_back(std::make_pair(Pattern, Variable.second));
+                    }
+                }
+                Translated.Account();
+                It = Instantiations.insert(std::make_pair(Key, std::move(Translated))).first;
+            }
+            Merged.Variables.insert(Merged.Variables.end(), It->second.Variables.begin(), It->second.Variables.end());
+            Merged.Method = std::min(Merged.Method, It->second.Method);
+        }
+        Merged.Account();
+        Apply(F, Merged);
+        return true;
+    }
+
+    static FunctionRecord::Verdict EvalMethod(clang::CXXMethodDecl const * const F,
+                                              RecordSummary const & Record,
+                                              Variables const & MemberReferences,
+                                              ScopeAnalysis const & Analysis) {
+        auto const AnyMemberVariable = [&Record, &MemberReferences](auto const & Predicate) {
+            return std::any_of(Record.MemberVariables.begin(), Record.MemberVariables.end(), Predicate)
+                || std::any_of(MemberReferences.begin(), MemberReferences.end(), Predicate);
+        };
         if ((! F->isVirtual()) &&
             (! F->isStatic()) &&
             F->isUserProvided() &&
                 CanThisMethodSignatureChange(F)
         ) {
-            Methods const MemberFunctions = GetMethodsFromRecord(RecordDecl);
-            for (auto && Variable: MemberVariables) {
-                if (Analysis.WasChanged(Variable)) {
-                    return;
-                }
+            Methods const & MemberFunctions = Record.MemberFunctions;
+            if (AnyMemberVariable([&Analysis](auto const Variable) { return Analysis.WasChanged(Variable); })) {
+                return FunctionRecord::None;
             }
             for (auto && Function: MemberFunctions) {
                 if (IsMutatingMethod(Function) && Analysis.WasReferenced(Function)) {
-                    return;
+                    return FunctionRecord::None;
                 }
             }
             // if it looks const, it might be even static..
-            bool NotMutateMember = ! IsCXXThisExpr::Check(F->getBody());
-            for (auto && Variable: MemberVariables) {
-                if (Analysis.WasReferenced(Variable)) {
-                    NotMutateMember = false;
-                }
+            bool NotMutateMember = ! Analysis.WasThisReferenced();
+            if (AnyMemberVariable([&Analysis](auto const Variable) { return Analysis.WasReferenced(Variable); })) {
+                NotMutateMember = false;
             }
             for (auto && Function : MemberFunctions) {
                 if (IsMemberMethod(Function) && Analysis.WasReferenced(Function)) {
@@ -173,28 +692,240 @@ public:
                 }
             }
             if (NotMutateMember) {
-                StaticCandidates.insert(F);
+                return FunctionRecord::Static;
             } else if (! F->isConst()) {
-                ConstCandidates.insert(F);
+                return FunctionRecord::Const;
             }
         }
+        return FunctionRecord::None;
     }
 
-    void Dump(clang::DiagnosticsEngine & DE) const {
-        State.GenerateReports(DE);
+    // Register the contribution of a function into the module state.
+    void Apply(clang::FunctionDecl const * const F, Contribution const & Result) {
+        State.Apply(Result.Variables);
+        if (FieldEffects * const Effects = GetEffectsRecord(F)) {
+            for (auto && Variable: Result.Variables) {
+                if (auto const Field = clang::dyn_cast<clang::FieldDecl const>(Variable.first)) {
+                    Effects->push_back(std::make_pair(Field, Variable.second));
+                }
+            }
+        }
+        if (auto const Method = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+            switch (Result.Method) {
+                case FunctionRecord::Static:
+                    StaticCandidates.insert(Method);
+                    break;
+                case FunctionRecord::Const:
+                    ConstCandidates.insert(Method);
+                    break;
+                case FunctionRecord::None:
+                    break;
+            }
+            MemoryAccount::Phase const Accounting(MemoryPhase::State);
+            CandidatesHeap.Update(ConstCandidates.getMemorySize() + StaticCandidates.getMemorySize());
+        }
+    }
+
+    // Summarise the parameter changes of the functions of the module, to
+    // evaluate the calls with those.
+    void SummariseParameters(clang::TranslationUnitDecl * const Unit) {
+        llvm::TimeTraceScope const Trace("ConstantineParameterSummaries");
+        MemoryAccount::Phase const Accounting(MemoryPhase::ScopeAnalysis);
+        Summaries = std::make_unique<ParameterSummaries>(Unit, [this](clang::FunctionDecl const * const F) {
+            return Filter.Contains(F);
+        });
+    }
+
+    // Headers which are the subject of the cache: analysed, but not the
+    // main file.
+    bool IsCacheable(clang::FileID const File) {
+        return (File != Sources.getMainFileID()) && Filter.Contains(File);
+    }
+
+    // The functions of this header are not analysed, the cached results
+    // are used instead.
+    void ReplayHeader(clang::FileID const File, HeaderFindings && Findings) {
+        Replayed.insert(std::make_pair(File, std::move(Findings)));
+    }
+
+    // The effects of the functions of this header are recorded, to store
+    // them in the cache.
+    void RecordHeader(clang::FileID const File) {
+        Recorded.insert(std::make_pair(File, FieldEffects()));
+    }
+
+    // Collect the results of a recorded header. It fails when a finding
+    // can't be expressed as an offset in the header.
+    bool CollectHeader(clang::FileID const File, HeaderFindings & Result) const {
+        auto const Effects = Recorded.find(File);
+        if (Recorded.end() == Effects)
+            return false;
+
+        auto const AddFinding = [this, File, &Result](Finding::Kind const Kind, clang::DeclaratorDecl const * const D) {
+            auto const Location = Sources.getDecomposedExpansionLoc(D->getBeginLoc());
+            if (Location.first != File)
+                return false;
+            Finding const F = MakeFinding(Kind, D);
+            Result.Findings.push_back(HeaderFinding { Kind, Location.second, GetName(F), GetUSR(F), GetFunction(F) });
+            return true;
+        };
+        for (auto && Variable: State.GetCandidates()) {
+            if ((! clang::isa<clang::FieldDecl>(Variable)) && (GetFileOf(Variable) == File)) {
+                if (! AddFinding(Finding::Variable, Variable))
+                    return false;
+            }
+        }
+        for (auto && Candidate: ConstCandidates) {
+            if (GetFileOf(Candidate) == File) {
+                if (! AddFinding(Finding::ConstFunction, Candidate))
+                    return false;
+            }
+        }
+        for (auto && Candidate: StaticCandidates) {
+            if (GetFileOf(Candidate) == File) {
+                if (! AddFinding(Finding::StaticFunction, Candidate))
+                    return false;
+            }
+        }
+        for (auto && Effect: Effects->second) {
+            Result.FieldEffects.push_back(HeaderFieldEffect { GetFieldKey(Effect.first), Effect.second });
+        }
+        return true;
+    }
+
+    void Dump(FindingSink & Sink, bool const WithFields) {
+        llvm::TimeTraceScope const Trace("ConstantineReport");
+        for (auto && Header: Replayed) {
+            for (auto && Effect: Header.second.FieldEffects) {
+                auto const It = Fields.find(Effect.Field);
+                if (Fields.end() != It) {
+                    State.Replay(It->second, Effect.Changed);
+                }
+            }
+        }
+        // The candidate sets are ordered by pointers (or not ordered at
+        // all), the findings are sorted by location before reported.
+        std::vector<Finding> Findings;
+        State.GenerateReports(Findings, Filter, WithFields);
         for (auto && Candidate: ConstCandidates) {
-            if (IsFromMainModule(Candidate)) {
-                EmitWarningMessage(DE, "function '%0' could be declared as const", Candidate);
+            if (Filter.Contains(Candidate)) {
+                Findings.push_back(MakeFinding(Finding::ConstFunction, Candidate));
             }
         }
         for (auto && Candidate: StaticCandidates) {
-            if (IsFromMainModule(Candidate)) {
-                EmitWarningMessage(DE, "function '%0' could be declared as static", Candidate);
+            if (Filter.Contains(Candidate)) {
+                Findings.push_back(MakeFinding(Finding::StaticFunction, Candidate));
             }
         }
+        for (auto && Header: Replayed) {
+            clang::SourceLocation const Start = Sources.getLocForStartOfFile(Header.first);
+            for (auto && Cached: Header.second.Findings) {
+                Findings.push_back(Finding { Cached.What, Start.getLocWithOffset(Cached.Offset), nullptr, Cached.Name, Cached.USR, Cached.Function });
+            }
+        }
+        SortFindings(Findings, Sources);
+        Sink.Report(Findings);
+    }
+
+    // The facts of the member variables (which are not declared in system
+    // headers), for the whole program verdict. Called after the report,
+    // which replays the cached header effects.
+    void WriteFieldFacts(llvm::raw_ostream & Stream) {
+        struct Owned {
+            std::string USR;
+            std::string Name;
+            std::string Location;
+            uint32_t Flags;
+        };
+        std::vector<Owned> Collected;
+        auto const Add = [this, &Collected](clang::DeclaratorDecl const * const Variable, uint32_t const Flags) {
+            auto const Field = clang::dyn_cast<clang::FieldDecl const>(Variable);
+            if ((nullptr == Field) || Sources.isInSystemHeader(Sources.getExpansionLoc(Field->getLocation())))
+                return;
+            Finding const F = MakeFinding(Finding::Variable, Field);
+            std::string USR = GetUSR(F);
+            if (USR.empty())
+                return;
+            clang::PresumedLoc const Presumed = Sources.getPresumedLoc(Sources.getExpansionLoc(F.Location));
+            std::string Location = (Presumed.isValid())
+                ? (std::string(Presumed.getFilename()) + ":" + std::to_string(Presumed.getLine()) + ":" + std::to_string(Presumed.getColumn()))
+                : std::string();
+            Collected.push_back(Owned { std::move(USR), GetName(F), std::move(Location),
+                                        Flags | (Filter.Contains(Field) ? uint32_t(FieldFact::Defined) : 0u) });
+        };
+        for (auto && Variable: State.GetCandidates()) {
+            Add(Variable, 0);
+        }
+        for (auto && Variable: State.GetChanged()) {
+            Add(Variable, FieldFact::Changed);
+        }
+        // The sets are not ordered, the facts are sorted to have the same
+        // file on every run.
+        std::sort(Collected.begin(), Collected.end(), [](Owned const & Lhs, Owned const & Rhs) {
+            return Lhs.USR < Rhs.USR;
+        });
+        std::vector<FieldFact> Facts;
+        for (auto && Fact: Collected) {
+            Facts.push_back(FieldFact { Fact.USR, Fact.Name, Fact.Location, Fact.Flags });
+        }
+        ::WriteFieldFacts(Stream, Facts);
     }
 
 private:
+    // The body might be analysed already by the parameter summaries.
+    ScopeAnalysis AnalyseBody(clang::FunctionDecl const * const F) const {
+        ScopeAnalysis Result;
+        if (Summaries && Summaries->Take(F, Result))
+            return Result;
+
+        llvm::TimeTraceScope const Trace("ConstantineScopeAnalysis", TraceDetail { F });
+        MemoryAccount::Phase const Accounting(MemoryPhase::ScopeAnalysis);
+        return ScopeAnalysis::AnalyseThis(*(F->getBody()), Summaries.get());
+    }
+
+    static RecordSummary const & CollectDeclarations(clang::CXXMethodDecl const * const F,
+                                                     clang::CXXRecordDecl const * const RecordDecl,
+                                                     RecordSummaryCache & RecordCache,
+                                                     AliasGraph & Aliases,
+                                                     Variables & Locals,
+                                                     Variables & MemberReferences) {
+        llvm::TimeTraceScope const Trace("ConstantineCollectDeclarations", TraceDetail { F });
+        MemoryAccount::Phase const Accounting(MemoryPhase::DeclarationCollector);
+        RecordSummary const & Record = RecordCache.Get(RecordDecl);
+        MemberReferences = Aliases.GetMemberReferences(Record.MemberVariables);
+        Locals = GetVariablesFromContext(F, (!CanThisMethodSignatureChange(F)));
+        return Record;
+    }
+
+    clang::FileID GetFileOf(clang::Decl const * const D) const {
+        return Sources.getFileID(Sources.getExpansionLoc(D->getLocation()));
+    }
+
+    bool IsReplayed(clang::Decl const * const D) const {
+        return clang::isa<clang::FunctionDecl>(D)
+            && (! Replayed.empty())
+            && (Replayed.end() != Replayed.find(GetFileOf(D)));
+    }
+
+    FieldEffects * GetEffectsRecord(clang::FunctionDecl const * const F) {
+        if (Recorded.empty())
+            return nullptr;
+
+        auto const It = Recorded.find(GetFileOf(F));
+        return (Recorded.end() == It) ? nullptr : &(It->second);
+    }
+
+    // Member variables are identified by their file, offset and name
+    // across translation units.
+    std::string GetFieldKey(clang::FieldDecl const * const F) const {
+        auto const Location = Sources.getDecomposedExpansionLoc(F->getLocation());
+        clang::FileEntry const * const Entry = Sources.getFileEntryForID(Location.first);
+        llvm::StringRef const Path = (nullptr == Entry)
+            ? llvm::StringRef()
+            : (Entry->tryGetRealPathName().empty() ? Entry->getName() : Entry->tryGetRealPathName());
+        return Path.str() + ":" + std::to_string(Location.second) + ":" + F->getNameAsString();
+    }
+
     inline
     static bool IsMutatingMethod(clang::CXXMethodDecl const * const F) {
         return (! F->isStatic()) && (! F->isConst());
@@ -206,21 +937,211 @@ private:
     }
 
 private:
+    clang::SourceManager const & Sources;
+    FunctionCache * const Functions;
+    llvm::StringRef const Fingerprint;
+    bool const WithInstantiations;
+    unsigned const Workers;
+    ModuleFilter Filter;
+    RecordSummaryCache Records;
     PseudoConstnessAnalysisState State;
-    Methods ConstCandidates;
-    Methods StaticCandidates;
+    // The method candidates grow with the whole module, like the sets of
+    // the state.
+    llvm::DenseSet<clang::CXXMethodDecl const *> ConstCandidates;
+    llvm::DenseSet<clang::CXXMethodDecl const *> StaticCandidates;
+    HeapUsage CandidatesHeap;
+    std::map<clang::FileID, HeaderFindings> Replayed;
+    std::map<clang::FileID, FieldEffects> Recorded;
+    std::map<std::string, clang::FieldDecl const *> Fields;
+    std::map<FunctionKey, Contribution> Instantiations;
+    std::unique_ptr<ParameterSummaries> Summaries;
+    std::vector<clang::FunctionDecl const *> Pending;
+    std::vector<clang::FunctionDecl const *> Patterns;
+    // Functions which were traversed out of the declaration order.
+    llvm::DenseSet<clang::Decl const *> Traversed;
+    clang::SourceLocation FirstLocal;
+    llvm::DenseMap<clang::FileID, bool> Visible;
 };
 
 } // namespace anonymous
 
 
-ModuleAnalysis::ModuleAnalysis(clang::CompilerInstance const &Compiler)
+struct ModuleAnalysis::Session {
+    std::unique_ptr<MemoryAccount> Memory;
+    std::unique_ptr<FunctionCache> Functions;
+    std::unique_ptr<PseudoConstnessAnalysis> Visitor;
+};
+
+ModuleAnalysis::ModuleAnalysis(clang::CompilerInstance &Compiler, ModuleAnalysisOptions const &Options)
     : clang::ASTConsumer()
     , Reporter(Compiler.getDiagnostics())
+    , Options(Options)
+    , Fingerprint(Compiler.getInvocation().getModuleHash())
+    , Headers()
+    , Cache()
+    , Streaming()
+{
+    if (Options.AnalyseHeaders && (! Options.CacheDirectory.empty())) {
+        Headers = std::make_shared<IncludeGraph>();
+        Cache = std::make_unique<HeaderCache>(Options.CacheDirectory);
+        Compiler.getPreprocessor().addPPCallbacks(
+            std::make_unique<IncludeTracker>(Compiler.getSourceManager(), Headers));
+    }
+}
+
+ModuleAnalysis::ModuleAnalysis(clang::DiagnosticsEngine &DE, ModuleAnalysisOptions const &Options)
+    : clang::ASTConsumer()
+    , Reporter(DE)
+    , Options(Options)
+    , Fingerprint()
+    , Headers()
+    , Cache()
+    , Streaming()
 { }
 
+ModuleAnalysis::~ModuleAnalysis() = default;
+
+std::unique_ptr<ModuleAnalysis::Session> ModuleAnalysis::StartSession(clang::ASTContext & Ctx) const {
+    clang::SourceManager const & SM = Ctx.getSourceManager();
+    auto Result = std::make_unique<Session>();
+    if (MemoryReport::None != Options.Memory) {
+        Result->Memory = std::make_unique<MemoryAccount>();
+    }
+    // The function cache is per translation unit.
+    if (! Options.CacheDirectory.empty()) {
+        clang::FileEntry const * const Entry = SM.getFileEntryForID(SM.getMainFileID());
+        if (Entry) {
+            llvm::StringRef const Path = Entry->tryGetRealPathName().empty() ? Entry->getName() : Entry->tryGetRealPathName();
+            Result->Functions = std::make_unique<FunctionCache>(Options.CacheDirectory, Path, Fingerprint);
+        }
+    }
+    Result->Visitor =
+        std::make_unique<PseudoConstnessAnalysis>(SM, Options.AnalyseHeaders, Options.AnalyseInstantiations,
+            // the lazy deserialization of an external AST source (PCH,
+            // modules) is not thread safe.
+            (Ctx.getExternalSource() ? 1u : Options.Jobs),
+            Result->Functions.get(), Fingerprint);
+    return Result;
+}
+
+void ModuleAnalysis::Initialize(clang::ASTContext & Ctx) {
+    if (Options.Streaming && (! Cache) && (! Options.SummariseParameters)) {
+        Streaming = StartSession(Ctx);
+    }
+}
+
+bool ModuleAnalysis::HandleTopLevelDecl(clang::DeclGroupRef Group) {
+    if (Streaming) {
+        MemoryAccount::Activation const Accounting(Streaming->Memory.get());
+        for (auto const D : Group) {
+            Streaming->Visitor->TraverseTopLevelDecl(D);
+        }
+    }
+    return true;
+}
+
+void ModuleAnalysis::HandleInlineFunctionDefinition(clang::FunctionDecl * const F) {
+    if (Streaming) {
+        MemoryAccount::Activation const Accounting(Streaming->Memory.get());
+        Streaming->Visitor->TraverseInlineFunction(F);
+    }
+}
+
+// The memory report goes to the standard error, or into a file next to
+// the findings.
+void ModuleAnalysis::ReportMemory(MemoryAccount const & Memory, clang::SourceManager const & SM) const {
+    clang::FileEntry const * const Entry = SM.getFileEntryForID(SM.getMainFileID());
+    llvm::StringRef const File = (nullptr == Entry) ? llvm::StringRef("stdin") : Entry->getName();
+    if (MemoryReport::Json != Options.Memory) {
+        Memory.Write(llvm::errs(), File, Options.Memory);
+        return;
+    }
+    if (auto const Stream = OpenOutput(SM, ".memory.json", llvm::sys::fs::OF_Text)) {
+        Memory.Write(*Stream, File, Options.Memory);
+    }
+}
+
+// The output files of a translation unit go into the findings directory.
+// Returns null when the file can't be opened (that is reported).
+std::unique_ptr<llvm::raw_ostream> ModuleAnalysis::OpenOutput(clang::SourceManager const & SM,
+                                                              llvm::StringRef const Extension,
+                                                              llvm::sys::fs::OpenFlags const Flags) const {
+    std::string const Path = GetOutputPath(Options.OutputDirectory, SM, Extension);
+    std::error_code Error;
+    auto Result = std::make_unique<llvm::raw_fd_ostream>(Path, Error, Flags);
+    if (Error) {
+        unsigned const Id = Reporter.getCustomDiagID(clang::DiagnosticsEngine::Error, "cannot open output file '%0': %1");
+        Reporter.Report(Id) << Path << Error.message();
+        return nullptr;
+    }
+    return Result;
+}
+
 void ModuleAnalysis::HandleTranslationUnit(clang::ASTContext & Ctx) {
-    std::unique_ptr<PseudoConstnessAnalysis> Visitor = std::make_unique<PseudoConstnessAnalysis>();
-    Visitor->TraverseDecl(Ctx.getTranslationUnitDecl());
-    Visitor->Dump(Reporter);
+    clang::SourceManager const & SM = Ctx.getSourceManager();
+    llvm::TimeTraceScope const Trace("Constantine", [&SM]() {
+        clang::FileEntry const * const Entry = SM.getFileEntryForID(SM.getMainFileID());
+        return (nullptr == Entry) ? std::string() : Entry->getName().str();
+    });
+    bool const WasStreamed = static_cast<bool>(Streaming);
+    std::unique_ptr<Session> const Current = (WasStreamed) ? std::move(Streaming) : StartSession(Ctx);
+    std::unique_ptr<FunctionCache> const & Functions = Current->Functions;
+    std::unique_ptr<PseudoConstnessAnalysis> const & Visitor = Current->Visitor;
+    MemoryAccount::Activation const Accounting(Current->Memory.get());
+    // The headers which were included more than once are not cached,
+    // because their declarations are not unique within the module.
+    std::vector<std::pair<clang::FileID, std::string>> Misses;
+    if (Cache) {
+        llvm::TimeTraceScope const LoadTrace("ConstantineHeaderCacheLoad");
+        HeaderKeys Keys(SM, *Headers, Fingerprint);
+        for (auto && File: Headers->Files) {
+            if ((! Visitor->IsCacheable(File)) || (1 != Headers->Entered.lookup(SM.getFileEntryForID(File))))
+                continue;
+
+            std::string const Key = Keys.Get(File);
+            HeaderFindings Findings;
+            if (Cache->Load(Key, Findings)) {
+                Visitor->ReplayHeader(File, std::move(Findings));
+            } else {
+                Visitor->RecordHeader(File);
+                Misses.push_back(std::make_pair(File, Key));
+            }
+        }
+    }
+    if (! WasStreamed) {
+        if (Options.SummariseParameters) {
+            Visitor->SummariseParameters(Ctx.getTranslationUnitDecl());
+        }
+        Visitor->TraverseLocalDecls(Ctx.getTranslationUnitDecl());
+    }
+    Visitor->Finish();
+    {
+        std::unique_ptr<FindingSink> const Sink =
+            CreateFindingSink(Options.Format, Options.OutputDirectory, Reporter, SM, Ctx.getLangOpts());
+        // The edits of the member variables are written anyway, the merge
+        // of the replacements checks those against the field verdict.
+        Visitor->Dump(*Sink, (! Options.FieldFacts) || (OutputFormat::Replacements == Options.Format));
+    }
+    if (Options.FieldFacts) {
+        if (auto const Stream = OpenOutput(SM, ".fields", llvm::sys::fs::OF_None)) {
+            Visitor->WriteFieldFacts(*Stream);
+        }
+    }
+    if (Current->Memory) {
+        ReportMemory(*Current->Memory, SM);
+    }
+    // Broken modules might have incomplete results.
+    if (Reporter.hasErrorOccurred())
+        return;
+
+    llvm::TimeTraceScope const StoreTrace("ConstantineCacheStore");
+    for (auto && Miss: Misses) {
+        HeaderFindings Findings;
+        if (Visitor->CollectHeader(Miss.first, Findings)) {
+            Cache->Store(Miss.second, Findings);
+        }
+    }
+    if (Functions) {
+        Functions->Store();
+    }
 }
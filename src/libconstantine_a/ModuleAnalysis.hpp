@@ -19,20 +19,82 @@
 
 #pragma once
 
+#include "FindingSink.hpp"
+#include "MemoryAccount.hpp"
+
+#include <memory>
+#include <string>
+
 #include <clang/AST/ASTConsumer.h>
 #include <clang/Frontend/CompilerInstance.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+struct IncludeGraph;
+class HeaderCache;
+
+// Settings of the analysis, which are not coming from the compiler.
+struct ModuleAnalysisOptions {
+    // Report findings from the user headers, not only from the main file.
+    bool AnalyseHeaders = false;
+    // Analyse the templates through their instantiations.
+    bool AnalyseInstantiations = false;
+    // Evaluate the calls by the parameter changes of the callee.
+    bool SummariseParameters = false;
+    // Number of worker threads for the functions of one translation
+    // unit. (0 and 1 means the analysis runs on the calling thread.)
+    unsigned Jobs = 1;
+    // Analyse the functions as the parser completes those, only the
+    // verdicts which depend on the whole translation unit are made at its
+    // end. (Not available with the header cache and the parameter
+    // summaries, those need the whole translation unit.)
+    bool Streaming = false;
+    // Report the heap allocations of the analysis containers.
+    MemoryReport Memory = MemoryReport::None;
+    // Directory of the header findings cache. Empty means no cache.
+    std::string CacheDirectory;
+    // Where the findings go. The file formats are written into the
+    // output directory, one file per translation unit.
+    OutputFormat Format = OutputFormat::Diagnostics;
+    std::string OutputDirectory = ".";
+    // Write the facts of the member variables into the output directory,
+    // and leave their verdict to the whole program merge. (The member
+    // variables might be changed by the functions of other translation
+    // units.)
+    bool FieldFacts = false;
+};
 
 // It runs the pseudo const analysis on the given translation unit.
 class ModuleAnalysis : public clang::ASTConsumer {
 public:
-    ModuleAnalysis(clang::CompilerInstance const &);
+    ModuleAnalysis(clang::CompilerInstance &, ModuleAnalysisOptions const &);
+    // Analysis of an AST which was built without compiler instance (eg.: by
+    // a tool). The header cache is not available, it needs the preprocessor.
+    ModuleAnalysis(clang::DiagnosticsEngine &, ModuleAnalysisOptions const &);
+    ~ModuleAnalysis() override;
 
+    void Initialize(clang::ASTContext &) override;
+    bool HandleTopLevelDecl(clang::DeclGroupRef) override;
+    void HandleInlineFunctionDefinition(clang::FunctionDecl *) override;
     void HandleTranslationUnit(clang::ASTContext &) override;
 
-
     ModuleAnalysis(ModuleAnalysis const &) = delete;
     ModuleAnalysis & operator=(ModuleAnalysis const &) = delete;
 
+private:
+    // The analysis of the translation unit. Created before the parsing in
+    // streaming mode, otherwise at the end of the translation unit.
+    struct Session;
+    std::unique_ptr<Session> StartSession(clang::ASTContext &) const;
+    void ReportMemory(MemoryAccount const &, clang::SourceManager const &) const;
+    std::unique_ptr<llvm::raw_ostream> OpenOutput(clang::SourceManager const &, llvm::StringRef Extension, llvm::sys::fs::OpenFlags) const;
+
 private:
     clang::DiagnosticsEngine & Reporter;
+    ModuleAnalysisOptions const Options;
+    std::string const Fingerprint;
+    std::shared_ptr<IncludeGraph> Headers;
+    std::unique_ptr<HeaderCache> Cache;
+    std::unique_ptr<Session> Streaming;
 };
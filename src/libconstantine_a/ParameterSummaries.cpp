@@ -0,0 +1,220 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ParameterSummaries.hpp"
+#include "DeclarationCollector.hpp"
+
+#include <clang/Analysis/CallGraph.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <llvm/ADT/SCCIterator.h>
+
+#include <algorithm>
+
+
+namespace {
+
+// Only these types can carry the address of a parameter.
+bool CanCarryAddress(clang::QualType const & Type) {
+    return (! Type.isNull())
+        && ((*Type).isReferenceType() || (*Type).isPointerType() || (*Type).isRecordType() || (*Type).isArrayType());
+}
+
+bool RefersTo(clang::Stmt const * const S, Variables const & Aliases) {
+    if (nullptr == S)
+        return false;
+    if (auto const E = clang::dyn_cast<clang::DeclRefExpr const>(S)) {
+        auto const D = clang::dyn_cast<clang::DeclaratorDecl const>(E->getDecl()->getCanonicalDecl());
+        if (D && Aliases.count(D))
+            return true;
+    }
+    for (auto && Child : S->children()) {
+        if (RefersTo(Child, Aliases))
+            return true;
+    }
+    return false;
+}
+
+// The parameter (or a local which refers to it) might be changed after
+// the function returned, when its address was stored, returned or
+// captured. This check is conservative: any of these counts as change.
+class EscapeCollector
+    : public clang::RecursiveASTVisitor<EscapeCollector> {
+public:
+    explicit EscapeCollector(Variables const & Aliases)
+        : clang::RecursiveASTVisitor<EscapeCollector>()
+        , Aliases(Aliases)
+        , Escaped(false)
+    { }
+
+    EscapeCollector(EscapeCollector const &) = delete;
+    EscapeCollector & operator=(EscapeCollector const &) = delete;
+
+    bool WasEscaped() const {
+        return Escaped;
+    }
+
+    bool VisitBinaryOperator(clang::BinaryOperator const * const E) {
+        if (E->isAssignmentOp()) {
+            Check(E->getRHS());
+        }
+        return ! Escaped;
+    }
+
+    bool VisitReturnStmt(clang::ReturnStmt const * const S) {
+        Check(S->getRetValue());
+        return ! Escaped;
+    }
+
+    bool VisitInitListExpr(clang::InitListExpr const * const E) {
+        for (auto && Init : E->inits()) {
+            Check(Init);
+        }
+        return ! Escaped;
+    }
+
+    bool VisitCXXConstructExpr(clang::CXXConstructExpr const * const E) {
+        auto const F = E->getConstructor();
+        auto const Args = std::min(E->getNumArgs(), F->getNumParams());
+        for (auto It = 0u; It < Args; ++It) {
+            auto const Type = F->getParamDecl(It)->getType();
+            if (! (((*Type).isReferenceType() || (*Type).isPointerType()) && (*Type).getPointeeType().isConstQualified())) {
+                Check(E->getArg(It));
+            }
+        }
+        return ! Escaped;
+    }
+
+    bool VisitVarDecl(clang::VarDecl const * const D) {
+        if (D->isStaticLocal() || (! D->isLocalVarDeclOrParm())) {
+            Check(D->getInit());
+        }
+        return ! Escaped;
+    }
+
+    bool VisitLambdaExpr(clang::LambdaExpr const * const E) {
+        for (auto && Capture : E->captures()) {
+            if (Capture.capturesVariable()) {
+                auto const D = clang::dyn_cast<clang::DeclaratorDecl const>(Capture.getCapturedVar()->getCanonicalDecl());
+                Escaped = Escaped || (D && Aliases.count(D));
+            }
+        }
+        return ! Escaped;
+    }
+
+private:
+    void Check(clang::Expr const * const E) {
+        Escaped = Escaped || (E && CanCarryAddress(E->getType()) && RefersTo(E, Aliases));
+    }
+
+private:
+    Variables const & Aliases;
+    bool Escaped;
+};
+
+bool IsNonConstReferenced(clang::QualType const & Type) {
+    return
+        ((*Type).isReferenceType() || (*Type).isPointerType())
+        && (! (*Type).getPointeeType().isConstQualified());
+}
+
+} // namespace anonymous
+
+
+ParameterSummaries::ParameterSummaries(clang::TranslationUnitDecl * const Unit, Predicate Keep)
+    : Summaries()
+    , Analyses()
+{
+    clang::CallGraph Graph;
+    // external declarations (of a precompiled header) are not loaded.
+    for (auto const D : Unit->noload_decls()) {
+        Graph.addToCallGraph(D);
+    }
+    // the components come in reverse topological order: callees first.
+    for (auto It = llvm::scc_begin(&Graph); ! It.isAtEnd(); ++It) {
+        for (auto && Node : *It) {
+            auto const F = clang::dyn_cast_or_null<clang::FunctionDecl const>(Node->getDecl());
+            clang::FunctionDecl const * const Definition = (F) ? F->getDefinition() : nullptr;
+            if (Definition && Definition->hasBody()) {
+                Summarise(Definition, Keep);
+            }
+        }
+    }
+}
+
+void ParameterSummaries::Summarise(clang::FunctionDecl const * const F, Predicate Keep) {
+    ScopeAnalysis Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()), this);
+
+    llvm::SmallBitVector Changed(F->getNumParams());
+    // the constructors might store the arguments in the members
+    bool const Storing = clang::isa<clang::CXXConstructorDecl>(F);
+    Variables const Locals = GetVariablesFromContext(F);
+    AliasGraph Graph(F);
+    for (auto It = 0u; It < F->getNumParams(); ++It) {
+        clang::ParmVarDecl const * const Parameter = F->getParamDecl(It);
+        if (! IsNonConstReferenced(Parameter->getType()))
+            continue;
+
+        Variables const Aliases = Graph.GetReferrers(Parameter, Locals);
+        bool Result = Storing;
+        for (auto && Alias : Aliases) {
+            Result = Result || Analysis.WasChanged(Alias);
+        }
+        if (! Result) {
+            EscapeCollector Visitor(Aliases);
+            Visitor.TraverseStmt(F->getBody());
+            Result = Visitor.WasEscaped();
+        }
+        Changed[It] = Result;
+    }
+    Summaries.insert(std::make_pair(F->getCanonicalDecl(), std::move(Changed)));
+
+    if (Keep(F)) {
+        Analyses.insert(std::make_pair(F, llvm::Optional<ScopeAnalysis>(std::move(Analysis))));
+    }
+}
+
+bool ParameterSummaries::MayChange(clang::FunctionDecl const * const F, unsigned const Index) const {
+    if (auto const Method = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+        if (Method->isVirtual())
+            return true;
+    }
+    auto const It = Summaries.find(F->getCanonicalDecl());
+    if (Summaries.end() == It)
+        return true;
+
+    return (Index >= It->second.size()) || It->second.test(Index);
+}
+
+std::string ParameterSummaries::GetSignature(clang::FunctionDecl const * const F) const {
+    std::string Result;
+    for (auto It = 0u; It < F->getNumParams(); ++It) {
+        Result.push_back(MayChange(F, It) ? '1' : '0');
+    }
+    return Result;
+}
+
+bool ParameterSummaries::Take(clang::FunctionDecl const * const F, ScopeAnalysis & Result) {
+    auto const It = Analyses.find(F);
+    if ((Analyses.end() == It) || (! It->second))
+        return false;
+
+    Result = std::move(*(It->second));
+    It->second.reset();
+    return true;
+}
@@ -0,0 +1,71 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "ScopeAnalysis.hpp"
+
+#include <map>
+#include <string>
+
+#include <clang/AST/AST.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallBitVector.h>
+
+
+// Which parameters of a function are changed by its body. The calls are
+// evaluated with these summaries, instead of assuming that every argument
+// passed by non-const reference (or pointer) was changed by the callee.
+//
+// The summaries are built bottom-up over the call graph of the translation
+// unit (by its strongly connected components), so every function body is
+// analysed once. Calls within a component are evaluated conservatively.
+class ParameterSummaries {
+public:
+    typedef llvm::function_ref<bool(clang::FunctionDecl const *)> Predicate;
+
+    // The scope analysis of the functions which match the predicate are
+    // kept, those can be taken by the module analysis.
+    ParameterSummaries(clang::TranslationUnitDecl *, Predicate Keep);
+
+    ParameterSummaries(ParameterSummaries const &) = delete;
+    ParameterSummaries & operator=(ParameterSummaries const &) = delete;
+
+    // It is conservative when the function has no summary: it was not
+    // defined in the translation unit, it is virtual or it was not
+    // summarised yet (called within its own component).
+    bool MayChange(clang::FunctionDecl const *, unsigned Index) const;
+
+    // The summary as a string, to put it into fingerprints.
+    std::string GetSignature(clang::FunctionDecl const *) const;
+
+    // The body analysis made while summarising, it can be taken once. The
+    // map itself is not modified, so it is safe to take the analysis of
+    // different functions concurrently.
+    bool Take(clang::FunctionDecl const *, ScopeAnalysis & Result);
+
+private:
+    void Summarise(clang::FunctionDecl const *, Predicate Keep);
+
+private:
+    llvm::DenseMap<clang::FunctionDecl const *, llvm::SmallBitVector> Summaries;
+    std::map<clang::FunctionDecl const *, llvm::Optional<ScopeAnalysis>> Analyses;
+};
@@ -0,0 +1,126 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Replacements.hpp"
+
+#include <llvm/ADT/SmallVector.h>
+
+
+namespace {
+
+// Single quoted YAML scalar, the quote is escaped by doubling it.
+void WriteQuoted(llvm::raw_ostream & OS, llvm::StringRef const Text) {
+    OS << '\'';
+    for (char const C : Text) {
+        if ('\'' == C)
+            OS << '\'';
+        OS << C;
+    }
+    OS << '\'';
+}
+
+bool ReadQuoted(llvm::StringRef Text, std::string & Result) {
+    Text = Text.trim();
+    if ((Text.size() < 2) || (! Text.startswith("'")) || (! Text.endswith("'")))
+        return false;
+
+    Text = Text.drop_front().drop_back();
+    Result.clear();
+    for (size_t It = 0; It < Text.size(); ++It) {
+        Result.push_back(Text[It]);
+        if (('\'' == Text[It]) && (It + 1 < Text.size()) && ('\'' == Text[It + 1]))
+            ++It;
+    }
+    return true;
+}
+
+} // namespace anonymous
+
+
+void WriteReplacementsBegin(llvm::raw_ostream & OS, llvm::StringRef const MainSourceFile) {
+    OS << "---\n";
+    OS << "MainSourceFile:  ";
+    WriteQuoted(OS, MainSourceFile);
+    OS << "\nReplacements:\n";
+}
+
+void WriteReplacement(llvm::raw_ostream & OS, Replacement const & R) {
+    if (! R.Field.empty()) {
+        OS << "  # Field:          ";
+        WriteQuoted(OS, R.Field);
+        OS << '\n';
+    }
+    OS << "  - FilePath:        ";
+    WriteQuoted(OS, R.FilePath);
+    OS << "\n    Offset:          " << R.Offset;
+    OS << "\n    Length:          " << R.Length;
+    OS << "\n    ReplacementText: ";
+    WriteQuoted(OS, R.Text);
+    OS << '\n';
+}
+
+void WriteReplacementsEnd(llvm::raw_ostream & OS) {
+    OS << "...\n";
+}
+
+bool ReadReplacements(llvm::StringRef const Content,
+                      std::string & MainSourceFile,
+                      llvm::function_ref<void(Replacement const &)> Callback) {
+    llvm::SmallVector<llvm::StringRef, 64> Lines;
+    Content.split(Lines, '\n', -1, false);
+
+    MainSourceFile.clear();
+    Replacement Current = { std::string(), 0, 0, std::string(), std::string() };
+    unsigned Fields = 0;
+    for (auto Line : Lines) {
+        Line = Line.trim();
+        if (Line.consume_front("- "))
+            Line = Line.ltrim();
+
+        std::pair<llvm::StringRef, llvm::StringRef> const Pair = Line.split(':');
+        llvm::StringRef const Key = Pair.first.trim();
+        llvm::StringRef const Value = Pair.second.trim();
+        if ("MainSourceFile" == Key) {
+            if ((0 != Fields) || (! ReadQuoted(Value, MainSourceFile)))
+                return false;
+        } else if ("# Field" == Key) {
+            if ((0 != Fields) || (! ReadQuoted(Value, Current.Field)))
+                return false;
+        } else if ("FilePath" == Key) {
+            if ((0 != Fields) || (! ReadQuoted(Value, Current.FilePath)))
+                return false;
+            Fields = 1;
+        } else if ("Offset" == Key) {
+            if ((1 != Fields) || Value.getAsInteger(10, Current.Offset))
+                return false;
+            Fields = 2;
+        } else if ("Length" == Key) {
+            if ((2 != Fields) || Value.getAsInteger(10, Current.Length))
+                return false;
+            Fields = 3;
+        } else if ("ReplacementText" == Key) {
+            if ((3 != Fields) || (! ReadQuoted(Value, Current.Text)))
+                return false;
+            Callback(Current);
+            Current.Field.clear();
+            Fields = 0;
+        }
+    }
+    return (0 == Fields);
+}
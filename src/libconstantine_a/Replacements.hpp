@@ -0,0 +1,53 @@
+/*  Copyright (C) 2012-2014  László Nagy
+    This file is part of Constantine.
+
+    Constantine implements pseudo const analysis.
+
+    Constantine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Constantine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+// A text replacement, as clang-apply-replacements expects.
+struct Replacement {
+    std::string FilePath;
+    unsigned Offset;
+    unsigned Length;
+    std::string Text;
+    // The USR of the member variable, when the edit makes that const.
+    // (Those edits are valid only when no other translation unit changes
+    // the member variable.) It is written as a comment, which
+    // clang-apply-replacements does not read.
+    std::string Field;
+};
+
+// The replacements file is the YAML document of clang-apply-replacements
+// (a main source file and the list of replacements). It is written in
+// pieces, to stream the replacements into it.
+void WriteReplacementsBegin(llvm::raw_ostream &, llvm::StringRef MainSourceFile);
+void WriteReplacement(llvm::raw_ostream &, Replacement const &);
+void WriteReplacementsEnd(llvm::raw_ostream &);
+
+// Reads the replacements from a file which was written by the functions
+// above. (It is not a generic YAML parser.) Returns false on syntax error.
+bool ReadReplacements(llvm::StringRef Content,
+                      std::string & MainSourceFile,
+                      llvm::function_ref<void(Replacement const &)>);
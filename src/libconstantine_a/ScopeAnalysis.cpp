@@ -18,59 +18,238 @@
  */
 
 #include "ScopeAnalysis.hpp"
-#include "IsCXXThisExpr.hpp"
+#include "ParameterSummaries.hpp"
 
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/Basic/Diagnostic.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Allocator.h>
 
-#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
 
 
 namespace {
 
 clang::QualType const NoType = clang::QualType();
-clang::SourceRange const NoRange = clang::SourceRange();
 
-// Usage extract method implemented in visitor style.
-class UsageExtractor
-    : public clang::RecursiveASTVisitor<UsageExtractor> {
+// The scratch containers of one body analysis. The memory comes from the
+// scratch arena, and released at once when the arena is reset.
+template <typename T>
+using ScratchVector = std::vector<T, ArenaAllocator<T>>;
+
+// The arena of the scratch state, one per thread. It is reset after every
+// body, which keeps its first slab for the next body. Its slabs are
+// reported to the memory account like the heap of a container.
+struct ScratchArena {
+    llvm::BumpPtrAllocator Allocator;
+    HeapUsage Heap;
+
+    void Reset() {
+        Heap.Update(Allocator.getTotalMemory());
+        Allocator.Reset();
+        Heap.Update(Allocator.getTotalMemory());
+    }
+};
+
+ScratchArena & GetScratchArena() {
+    thread_local ScratchArena Arena;
+    return Arena;
+}
+
+// The usage type of a variable is the type of the first interesting
+// expression above the variable reference. (Or the type given by the
+// parameter declaration, when it was passed by reference.) Each context
+// tracks this type till the next variable reference, then starts over.
+//
+// Contexts can be nested, each of them registers the variables with its
+// own type. After a registration all the active contexts are in the same
+// state. Those are kept as one entry, therefore a registration costs only
+// as much as the number of contexts opened since the previous one.
+class UsageContexts {
 public:
-    UsageExtractor(UsageRefsMap & Out, clang::QualType const & InType)
-        : clang::RecursiveASTVisitor<UsageExtractor>()
-        , Results(Out)
-        , State(InType, NoRange)
+    explicit UsageContexts(llvm::BumpPtrAllocator & Arena)
+        : Frames(ArenaAllocator<clang::QualType>(Arena))
+        , Uncaptured()
+        , Settled(0)
+        , Shared()
     { }
 
-    UsageExtractor(UsageExtractor const &) = delete;
-    UsageExtractor & operator=(UsageExtractor const &) = delete;
+    UsageContexts(UsageContexts const &) = delete;
+    UsageContexts & operator=(UsageContexts const &) = delete;
 
-private:
+    void Push(clang::QualType const & Type) {
+        if (Type.isNull()) {
+            Uncaptured.push_back(Frames.size());
+        }
+        Frames.push_back(Type);
+    }
+
+    void Pop() {
+        auto const Index = Frames.size() - 1;
+        if (Settled > Index) {
+            Settled = Index;
+        } else if ((! Uncaptured.empty()) && (Uncaptured.back() == Index)) {
+            Uncaptured.pop_back();
+        }
+        Frames.pop_back();
+    }
+
+    // Contexts without type info take the type of the given expression.
     void Capture(clang::Expr const * const E) {
-        // do nothing if it already has type info
-        if (std::get<0>(State) != NoType)
-            return;
+        if ((0 < Settled) && Shared.isNull()) {
+            Shared = E->getType();
+        }
+        for (auto const Index : Uncaptured) {
+            Frames[Index] = E->getType();
+        }
+        Uncaptured.clear();
+    }
 
-        State = std::make_tuple(E->getType(), E->getSourceRange());
+    // Call the function with the distinct types of the active contexts and
+    // the number of contexts in that type, then reset all of them for the
+    // next variable reference.
+    template <typename F>
+    void Register(F const & Function) {
+        llvm::SmallVector<std::pair<clang::QualType, unsigned>, 4> Types;
+        if (0 < Settled) {
+            Types.push_back(std::make_pair(Shared, static_cast<unsigned>(Settled)));
+        }
+        for (auto Index = Settled; Index < Frames.size(); ++Index) {
+            auto const It = llvm::find_if(Types, [this, Index](std::pair<clang::QualType, unsigned> const & Entry) {
+                return Entry.first == Frames[Index];
+            });
+            if (Types.end() != It) {
+                ++(It->second);
+            } else {
+                Types.push_back(std::make_pair(Frames[Index], 1u));
+            }
+        }
+        for (auto && Type : Types) {
+            Function(Type.first, Type.second);
+        }
+        Reset();
+    }
+
+    // Call the function with the type of each active context and its index.
+    // Contexts which were registered together share the type, those are
+    // given as one index range. Then reset all of them, like above.
+    template <typename F>
+    void RegisterEach(F const & Function) {
+        if (0 < Settled) {
+            Function(Shared, std::size_t(0), Settled);
+        }
+        for (auto Index = Settled; Index < Frames.size(); ++Index) {
+            Function(Frames[Index], Index, Index + 1);
+        }
+        Reset();
+    }
+
+private:
+    void Reset() {
+        Uncaptured.clear();
+        Settled = Frames.size();
+        Shared = NoType;
     }
 
-    void RegisterUsage(clang::ValueDecl const * const Decl,
-                       clang::SourceRange const & Location) {
-        std::get<1>(State) = Location;
-        if (auto const D = clang::dyn_cast<clang::DeclaratorDecl const>(Decl->getCanonicalDecl())) {
-            auto It = Results.find(D);
-            if (Results.end() == It) {
-                auto const R = Results.insert(UsageRefsMap::value_type(D, UsageRefs()));
-                It = R.first;
+private:
+    ScratchVector<clang::QualType> Frames;
+    llvm::SmallVector<std::size_t, 4> Uncaptured;
+    std::size_t Settled;
+    clang::QualType Shared;
+};
+
+
+// Collect all variables which were mutated or accessed in the given scope.
+// (The scope is given by the TraverseStmt method.)
+//
+// The mutating expressions (like assignment, increment, passing argument
+// by reference) register their operand when visited. The operand opens a
+// change context when its traversal begins, and all variable references
+// inside it are registered as changed. Member access on 'this' opens a
+// usage context the same way. So every node is visited only once.
+//
+// Whether a member access is on 'this' is known only after its traversal.
+// Therefore every member access opens a usage context and keeps the
+// registrations aside. Those are accepted or dropped at the end of the
+// member access traversal, depending on that 'this' was seen or not.
+// Member accesses can be nested (like 'this->a.b'), then each of them
+// accepts the references inside it.
+template <typename Records>
+class UsageCollector
+    : public clang::RecursiveASTVisitor<UsageCollector<Records>> {
+public:
+    UsageCollector(Records & ChangedOut, Records & UsedOut, bool & ThisOut, ParameterSummaries const * const Summaries, llvm::BumpPtrAllocator & Arena)
+        : clang::RecursiveASTVisitor<UsageCollector<Records>>()
+        , Summaries(Summaries)
+        , Changed(ChangedOut)
+        , Used(UsedOut)
+        , ThisReferenced(ThisOut)
+        , Pending()
+        , PendingHeap()
+        , Opened(ArenaAllocator<OpenedContexts>(Arena))
+        , Changes(Arena)
+        , Usages(Arena)
+        , UsageFrames(ArenaAllocator<UsageFrame>(Arena))
+        , Candidates(ArenaAllocator<UsageCandidate>(Arena))
+    { }
+
+    UsageCollector(UsageCollector const &) = delete;
+    UsageCollector & operator=(UsageCollector const &) = delete;
+
+public:
+    // Open the contexts of the node, before its traversal begins.
+    bool dataTraverseStmtPre(clang::Stmt * const Stmt) {
+        unsigned ChangeContexts = 0;
+        {
+            auto const It = Pending.find(Stmt);
+            if (Pending.end() != It) {
+                for (auto && Type : It->second) {
+                    Changes.Push(Type);
+                    ++ChangeContexts;
+                }
+                Pending.erase(It);
             }
-            UsageRefs & Ls = It->second;
-            Ls.push_back(State);
         }
-        // reset the state for the next call
-        State = std::make_tuple(NoType, NoRange);
+        bool const UsageContext = clang::isa<clang::MemberExpr>(Stmt);
+        if (UsageContext) {
+            Usages.Push(NoType);
+            UsageFrames.push_back(UsageFrame { Candidates.size(), false });
+        }
+        if (ChangeContexts || UsageContext) {
+            Opened.push_back(OpenedContexts { Stmt, ChangeContexts, UsageContext });
+        }
+        return true;
+    }
+
+    // Close the contexts of the node, after its traversal finished.
+    bool dataTraverseStmtPost(clang::Stmt * const Stmt) {
+        if ((! Opened.empty()) && (Opened.back().Node == Stmt)) {
+            for (auto It = 0u; It < Opened.back().Changes; ++It) {
+                Changes.Pop();
+            }
+            if (Opened.back().Usage) {
+                Usages.Pop();
+                ResolveUsages();
+            }
+            Opened.pop_back();
+        }
+        return true;
     }
 
 public:
-    // public visitor method.
+    bool VisitCXXThisExpr(clang::CXXThisExpr const *) {
+        ThisReferenced = true;
+        if (! UsageFrames.empty()) {
+            UsageFrames.back().OnThis = true;
+        }
+        return true;
+    }
+
     bool VisitCastExpr(clang::CastExpr const * const E) {
         Capture(E);
         return true;
@@ -84,59 +263,29 @@ public:
         default:
             ;
         }
+        // Inc/Dec-rement operator does mutate variables.
+        if (E->isIncrementDecrementOp()) {
+            Mutated(E->getSubExpr());
+        }
         return true;
     }
 
     bool VisitDeclRefExpr(clang::DeclRefExpr const * const E) {
         Capture(E);
-        RegisterUsage(E->getDecl(), E->getSourceRange());
+        Register(E->getDecl(), E->getSourceRange(), E->getType());
         return true;
     }
 
     bool VisitMemberExpr(clang::MemberExpr const * const E) {
         Capture(E);
-        RegisterUsage(E->getMemberDecl(), E->getSourceRange());
+        Register(E->getMemberDecl(), E->getSourceRange(), NoType);
         return true;
     }
 
-private:
-    UsageRefsMap & Results;
-    UsageRef State;
-};
-
-void Register(UsageRefsMap & Results,
-              clang::Expr const * E,
-              clang::QualType const & Type = clang::QualType()) {
-    clang::Stmt const * const Stmt = E;
-
-    UsageExtractor Visitor(Results, Type);
-    Visitor.TraverseStmt(const_cast<clang::Stmt*>(Stmt));
-}
-
-
-// Collect all variables which were mutated in the given scope.
-// (The scope is given by the TraverseStmt method.)
-class VariableChangeCollector
-    : public clang::RecursiveASTVisitor<VariableChangeCollector> {
-public:
-    explicit VariableChangeCollector(UsageRefsMap & Out)
-        : clang::RecursiveASTVisitor<VariableChangeCollector>()
-        , Results(Out)
-    { }
-
-public:
     // Assignments are mutating variables.
     bool VisitBinaryOperator(clang::BinaryOperator const * const Stmt) {
         if (Stmt->isAssignmentOp()) {
-            Register(Results, Stmt->getLHS());
-        }
-        return true;
-    }
-
-    // Inc/Dec-rement operator does mutate variables.
-    bool VisitUnaryOperator(clang::UnaryOperator const * const Stmt) {
-        if (Stmt->isIncrementDecrementOp()) {
-            Register(Results, Stmt->getSubExpr());
+            Mutated(Stmt->getLHS());
         }
         return true;
     }
@@ -148,8 +297,8 @@ public:
         auto const Args = std::min(Stmt->getNumArgs(), F->getNumParams());
         for (auto It = 0u; It < Args; ++It) {
             auto const P = F->getParamDecl(It);
-            if (IsNonConstReferenced(P->getType())) {
-                Register(Results, Stmt->getArg(It), (*(P->getType())).getPointeeType());
+            if (IsNonConstReferenced(P->getType()) && MayChange(F, It)) {
+                Mutated(Stmt->getArg(It), (*(P->getType())).getPointeeType());
             }
         }
         return true;
@@ -166,10 +315,10 @@ public:
             auto const Args = std::min(Stmt->getNumArgs(), F->getNumParams());
             for (auto It = 0u; It < Args; ++It) {
                 auto const P = F->getParamDecl(It);
-                if (IsNonConstReferenced(P->getType())) {
+                if (IsNonConstReferenced(P->getType()) && MayChange(F, It)) {
                     assert(It + Offset <= Stmt->getNumArgs());
-                    Register(Results, Stmt->getArg(It + Offset),
-                                 (*(P->getType())).getPointeeType());
+                    Mutated(Stmt->getArg(It + Offset),
+                            (*(P->getType())).getPointeeType());
                 }
             }
         }
@@ -180,7 +329,7 @@ public:
     bool VisitCXXMemberCallExpr(clang::CXXMemberCallExpr const * const Stmt) {
         if (auto const MD = Stmt->getMethodDecl()) {
             if ((! MD->isConst()) && (! MD->isStatic())) {
-                Register(Results, Stmt->getImplicitObjectArgument());
+                Mutated(Stmt->getImplicitObjectArgument());
             }
         }
         return true;
@@ -193,7 +342,7 @@ public:
         if (auto const F = Stmt->getDirectCallee()) {
             if (auto const MD = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
                 if ((! MD->isConst()) && (! MD->isStatic()) && (0 < Stmt->getNumArgs())) {
-                    Register(Results, Stmt->getArg(0));
+                    Mutated(Stmt->getArg(0));
                 }
             }
         }
@@ -205,12 +354,16 @@ public:
         auto const Args = Stmt->getNumPlacementArgs();
         for (auto It = 0u; It < Args; ++It) {
             // FIXME: not all placement argument are mutating.
-            Register(Results, Stmt->getPlacementArg(It));
+            Mutated(Stmt->getPlacementArg(It));
         }
         return true;
     }
 
 private:
+    bool MayChange(clang::FunctionDecl const * const F, unsigned const Index) const {
+        return (nullptr == Summaries) || Summaries->MayChange(F, Index);
+    }
+
     static bool IsNonConstReferenced(clang::QualType const & Decl) {
         return
             ((*Decl).isReferenceType() || (*Decl).isPointerType())
@@ -224,68 +377,122 @@ private:
             (clang::dyn_cast<clang::CXXMethodDecl const>(Stmt->getDirectCallee()));
     }
 
-private:
-    UsageRefsMap & Results;
-};
+    static clang::DeclaratorDecl const * GetDeclarator(clang::ValueDecl const * const Decl) {
+        return clang::dyn_cast<clang::DeclaratorDecl const>(Decl->getCanonicalDecl());
+    }
 
-// Collect all variables which were accessed in the given scope.
-// (The scope is given by the TraverseStmt method.)
-class VariableAccessCollector
-    : public clang::RecursiveASTVisitor<VariableAccessCollector> {
-public:
-    explicit VariableAccessCollector(UsageRefsMap & Out)
-        : clang::RecursiveASTVisitor<VariableAccessCollector>()
-        , Results(Out)
-    { }
+    // The operand will open a change context when its traversal begins.
+    void Mutated(clang::Expr const * const E, clang::QualType const & Type = NoType) {
+        if (E) {
+            Pending[E].push_back(Type);
+            PendingHeap.Update(Pending.getMemorySize());
+        }
+    }
 
-public:
-    bool VisitDeclRefExpr(clang::DeclRefExpr const * const Stmt) {
-        Register(Results, Stmt);
-        return true;
+    void Capture(clang::Expr const * const E) {
+        Changes.Capture(E);
+        Usages.Capture(E);
     }
 
-    bool VisitMemberExpr(clang::MemberExpr const * const Stmt) {
-        if (IsCXXThisExpr::Check(Stmt)) {
-            Register(Results, Stmt);
+    // Register the reference in the active contexts. A variable reference
+    // is a usage context by itself (regardless of the enclosing member
+    // accesses), while a member access is not.
+    void Register(clang::ValueDecl const * const Decl,
+                  clang::SourceRange const & Location,
+                  clang::QualType const & OwnType) {
+        auto const D = GetDeclarator(Decl);
+        Changes.Register([&](clang::QualType const & Type, unsigned const Contexts) {
+            if (D) {
+                Changed.Insert(D, Type, Location, Contexts);
+            }
+        });
+        Usages.RegisterEach([&](clang::QualType const & Type, std::size_t const First, std::size_t const Last) {
+            if (D) {
+                Candidates.push_back(UsageCandidate { D, Type, Location, First, Last });
+            }
+        });
+        if (D && (! OwnType.isNull())) {
+            Used.Insert(D, OwnType, Location);
         }
-        return true;
+    }
+
+    // At the end of the innermost usage context: the registrations in it
+    // are accepted when it was a member access on 'this'. (Then the
+    // enclosing member accesses are on 'this' too.) The candidates are kept
+    // while those are registered in an enclosing context.
+    void ResolveUsages() {
+        auto const Context = UsageFrames.size() - 1;
+        auto const Frame = UsageFrames.back();
+        UsageFrames.pop_back();
+        if (Frame.OnThis && (! UsageFrames.empty())) {
+            UsageFrames.back().OnThis = true;
+        }
+        auto Kept = Candidates.begin() + Frame.Candidates;
+        for (auto It = Kept; Candidates.end() != It; ++It) {
+            if (It->Last == Context + 1) {
+                if (Frame.OnThis) {
+                    Used.Insert(It->Decl, It->Type, It->Location);
+                }
+                It->Last = Context;
+            }
+            if (It->First < It->Last) {
+                *Kept++ = *It;
+            }
+        }
+        Candidates.erase(Kept, Candidates.end());
     }
 
 private:
-    UsageRefsMap & Results;
+    struct OpenedContexts {
+        clang::Stmt const * Node;
+        unsigned Changes;
+        bool Usage;
+    };
+
+    struct UsageFrame {
+        std::size_t Candidates;
+        bool OnThis;
+    };
+
+    // The reference registered in the usage contexts of the index range.
+    struct UsageCandidate {
+        clang::DeclaratorDecl const * Decl;
+        clang::QualType Type;
+        clang::SourceRange Location;
+        std::size_t First;
+        std::size_t Last;
+    };
+
+    ParameterSummaries const * const Summaries;
+    Records & Changed;
+    Records & Used;
+    bool & ThisReferenced;
+    llvm::DenseMap<clang::Stmt const *, llvm::SmallVector<clang::QualType, 1>> Pending;
+    HeapUsage PendingHeap;
+    ScratchVector<OpenedContexts> Opened;
+    UsageContexts Changes;
+    UsageContexts Usages;
+    ScratchVector<UsageFrame> UsageFrames;
+    ScratchVector<UsageCandidate> Candidates;
 };
 
 } // namespace anonymous
 
-ScopeAnalysis ScopeAnalysis::AnalyseThis(clang::Stmt const & Stmt) {
-    ScopeAnalysis Result;
+template <typename Records>
+BasicScopeAnalysis<Records> BasicScopeAnalysis<Records>::AnalyseThis(clang::Stmt const & Stmt, ParameterSummaries const * const Summaries) {
+    BasicScopeAnalysis<Records> Result;
+    // only the records survive the collector, its scratch state is
+    // released with the arena.
+    ScratchArena & Arena = GetScratchArena();
     {
-        VariableChangeCollector Visitor(Result.Changed);
-        Visitor.TraverseStmt(const_cast<clang::Stmt*>(&Stmt));
-    }
-    {
-        VariableAccessCollector Visitor(Result.Used);
+        UsageCollector<Records> Visitor(Result.Changed, Result.Used, Result.ThisReferenced, Summaries, Arena.Allocator);
         Visitor.TraverseStmt(const_cast<clang::Stmt*>(&Stmt));
     }
+    Arena.Reset();
+    Result.Changed.Seal();
+    Result.Used.Seal();
     return Result;
 }
 
-bool ScopeAnalysis::WasChanged(clang::DeclaratorDecl const * const Decl) const {
-    return (Changed.end() != Changed.find(Decl));
-}
-
-bool ScopeAnalysis::WasReferenced(clang::DeclaratorDecl const * const Decl) const {
-    return (Used.end() != Used.find(Decl));
-}
-
-void ScopeAnalysis::ForEachChanged(std::function<void(UsageRefsMap::value_type const &)> const &Function) const {
-    for (auto && Entry: Changed) {
-        Function(Entry);
-    }
-}
-
-void ScopeAnalysis::ForEachReferenced(std::function<void(UsageRefsMap::value_type const &)> const &Function) const {
-    for (auto && Entry: Used) {
-        Function(Entry);
-    }
-}
+template class BasicScopeAnalysis<DeclarationRecords>;
+template class BasicScopeAnalysis<UsageRecords>;
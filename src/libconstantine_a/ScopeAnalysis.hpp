@@ -19,40 +19,231 @@
 
 #pragma once
 
-#include <utility>
-#include <list>
-#include <map>
+#include "MemoryAccount.hpp"
+
+#include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <clang/AST/AST.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/iterator_range.h>
+#include <llvm/Support/Allocator.h>
+
+class ParameterSummaries;
+
+// Allocator of containers, which memory comes from an arena, and released
+// at once with the arena. (The buffers left behind by a growing vector are
+// not reused, the geometric growth keeps that waste bounded.)
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    // a moved container keeps its buffer, which is still in the arena.
+    typedef std::true_type propagate_on_container_move_assignment;
 
+    explicit ArenaAllocator(llvm::BumpPtrAllocator & Arena)
+        : Arena(&Arena)
+    { }
+
+    template <typename U>
+    ArenaAllocator(ArenaAllocator<U> const & Other)
+        : Arena(Other.Arena)
+    { }
+
+    T * allocate(std::size_t const Count) {
+        return Arena->Allocate<T>(Count);
+    }
+
+    void deallocate(T *, std::size_t) {
+    }
+
+    template <typename U>
+    bool operator==(ArenaAllocator<U> const & Other) const {
+        return Arena == Other.Arena;
+    }
+
+    template <typename U>
+    bool operator!=(ArenaAllocator<U> const & Other) const {
+        return Arena != Other.Arena;
+    }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    llvm::BumpPtrAllocator * Arena;
+};
 
 // One variable could have been used multiple times with different type.
-typedef std::tuple<clang::QualType, clang::SourceRange> UsageRef;
-typedef std::list<UsageRef> UsageRefs;
-typedef std::map<clang::DeclaratorDecl const *, UsageRefs> UsageRefsMap;
+struct UsageRef {
+    clang::DeclaratorDecl const * Decl;
+    clang::QualType Type;
+    clang::SourceRange Location;
+};
+
+// Recording policy of the scope analysis, which keeps only the set of the
+// declarations. That is all the pseudo constness analysis needs.
+class DeclarationRecords {
+public:
+    DeclarationRecords()
+        : Decls()
+        , Heap()
+    { }
+    DeclarationRecords(DeclarationRecords &&) = default;
+
+    DeclarationRecords & operator=(DeclarationRecords && Other) {
+        Decls = std::move(Other.Decls);
+        Heap = std::move(Other.Heap);
+        Heap.Update(GetHeapBytes());
+        return *this;
+    }
+
+    void Insert(clang::DeclaratorDecl const * const Decl, clang::QualType const &, clang::SourceRange const &, unsigned const = 1) {
+        Decls.push_back(Decl);
+        Heap.Update(GetHeapBytes());
+    }
+
+    void Seal() {
+        std::sort(Decls.begin(), Decls.end(), std::less<clang::DeclaratorDecl const *>());
+        Decls.erase(std::unique(Decls.begin(), Decls.end()), Decls.end());
+    }
+
+    bool Contains(clang::DeclaratorDecl const * const Decl) const {
+        return std::binary_search(Decls.begin(), Decls.end(), Decl, std::less<clang::DeclaratorDecl const *>());
+    }
+
+private:
+    std::size_t GetHeapBytes() const {
+        return (Decls.capacity() > 16) ? (Decls.capacity() * sizeof(clang::DeclaratorDecl const *)) : 0;
+    }
+
+private:
+    llvm::SmallVector<clang::DeclaratorDecl const *, 16> Decls;
+    HeapUsage Heap;
+};
+
+// Recording policy of the scope analysis, which keeps every usage with its
+// type and location. (Used by the debug plugin.) The usages are stored in
+// one vector, and grouped by declarations when sealed. The vector outlives
+// the traversal (and its scratch arena), therefore the records have their
+// own arena, which moves with the analysis result.
+//
+// A reference inside nested contexts is recorded once for every context,
+// even if those have the same type.
+class UsageRecords {
+    typedef std::vector<UsageRef, ArenaAllocator<UsageRef>> Container;
+
+public:
+    typedef Container::const_iterator iterator;
+
+    UsageRecords()
+        : Arena(new llvm::BumpPtrAllocator())
+        , Usages(ArenaAllocator<UsageRef>(*Arena))
+    { }
+    UsageRecords(UsageRecords &&) = default;
+
+    // the buffer of the other vector lives in the other arena.
+    UsageRecords & operator=(UsageRecords && Other) {
+        Usages = std::move(Other.Usages);
+        Arena = std::move(Other.Arena);
+        return *this;
+    }
+
+    UsageRecords(UsageRecords const &) = delete;
+    UsageRecords & operator=(UsageRecords const &) = delete;
+
+    void Insert(clang::DeclaratorDecl const * const Decl, clang::QualType const & Type, clang::SourceRange const & Location, unsigned const Count = 1) {
+        Usages.insert(Usages.end(), Count, UsageRef { Decl, Type, Location });
+    }
+
+    void Seal() {
+        std::stable_sort(Usages.begin(), Usages.end(), [](UsageRef const & Lhs, UsageRef const & Rhs) {
+            return std::less<clang::DeclaratorDecl const *>()(Lhs.Decl, Rhs.Decl);
+        });
+    }
+
+    bool Contains(clang::DeclaratorDecl const * const Decl) const {
+        auto const It = std::lower_bound(Usages.begin(), Usages.end(), Decl, [](UsageRef const & Lhs, clang::DeclaratorDecl const * const Rhs) {
+            return std::less<clang::DeclaratorDecl const *>()(Lhs.Decl, Rhs);
+        });
+        return (Usages.end() != It) && (It->Decl == Decl);
+    }
+
+    // Call the function with every declaration and the range of its usages.
+    template <typename F>
+    void ForEach(F const & Function) const {
+        for (auto Begin = Usages.begin(), End = Usages.end(); Begin != End; ) {
+            auto const Decl = Begin->Decl;
+            auto const Last = std::find_if(Begin, End, [Decl](UsageRef const & Usage) { return Usage.Decl != Decl; });
+            Function(Decl, llvm::make_range(Begin, Last));
+            Begin = Last;
+        }
+    }
+
+private:
+    std::unique_ptr<llvm::BumpPtrAllocator> Arena;
+    Container Usages;
+};
+
 
 // This class tracks the usage of variables in a statement body to see
 // if they are never written to, implying that they constant.
-class ScopeAnalysis {
+//
+// What is kept about the usages is decided by the recording policy.
+template <typename Records>
+class BasicScopeAnalysis {
 public:
-    static ScopeAnalysis AnalyseThis(clang::Stmt const &);
+    // The calls are evaluated by the parameter summaries when those given.
+    static BasicScopeAnalysis AnalyseThis(clang::Stmt const &, ParameterSummaries const * = nullptr);
 
-    bool WasChanged(clang::DeclaratorDecl const *) const;
-    bool WasReferenced(clang::DeclaratorDecl const *) const;
+    bool WasChanged(clang::DeclaratorDecl const * const Decl) const {
+        return Changed.Contains(Decl);
+    }
 
-    void ForEachChanged(std::function<void(UsageRefsMap::value_type const &)> const & Function) const;
-    void ForEachReferenced(std::function<void(UsageRefsMap::value_type const &)> const & Function) const;
+    bool WasReferenced(clang::DeclaratorDecl const * const Decl) const {
+        return Used.Contains(Decl);
+    }
+
+    bool WasThisReferenced() const {
+        return ThisReferenced;
+    }
+
+    template <typename F>
+    void ForEachChanged(F const & Function) const {
+        Changed.ForEach(Function);
+    }
+
+    template <typename F>
+    void ForEachReferenced(F const & Function) const {
+        Used.ForEach(Function);
+    }
 
 public:
-    ScopeAnalysis() = default;
-    ScopeAnalysis(ScopeAnalysis &&) = default;
-    ScopeAnalysis & operator=(ScopeAnalysis &&) = default;
+    BasicScopeAnalysis()
+        : Changed()
+        , Used()
+        , ThisReferenced(false)
+    { }
+    BasicScopeAnalysis(BasicScopeAnalysis &&) = default;
+    BasicScopeAnalysis & operator=(BasicScopeAnalysis &&) = default;
 
-    ScopeAnalysis(ScopeAnalysis const &) = delete;
-    ScopeAnalysis & operator=(ScopeAnalysis const &) = delete;
+    BasicScopeAnalysis(BasicScopeAnalysis const &) = delete;
+    BasicScopeAnalysis & operator=(BasicScopeAnalysis const &) = delete;
 
 private:
-    UsageRefsMap Changed;
-    UsageRefsMap Used;
+    Records Changed;
+    Records Used;
+    bool ThisReferenced;
 };
+
+// Both variants are instantiated in ScopeAnalysis.cpp.
+extern template class BasicScopeAnalysis<DeclarationRecords>;
+extern template class BasicScopeAnalysis<UsageRecords>;
+
+typedef BasicScopeAnalysis<DeclarationRecords> ScopeAnalysis;
+typedef BasicScopeAnalysis<UsageRecords> DebugScopeAnalysis;
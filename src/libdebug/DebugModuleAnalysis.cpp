@@ -42,16 +42,16 @@ void EmitNoteMessage(clang::DiagnosticsEngine & DE, char const (&Message)[N], cl
 }
 
 template <unsigned N>
-void EmitNoteMessage(clang::DiagnosticsEngine &DE, const char (&Message)[N], UsageRefsMap::value_type const &Var) {
-    if (!IsFromMainModule(Var.first))
+void EmitNoteMessage(clang::DiagnosticsEngine &DE, const char (&Message)[N], clang::DeclaratorDecl const * const V,
+                     llvm::iterator_range<UsageRecords::iterator> const &Usages) {
+    if (!IsFromMainModule(V))
         return;
 
     auto const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Note, Message);
-    auto const & Ls = Var.second;
-    for (auto const &L : Ls) {
-        auto const DB = DE.Report(std::get<1>(L).getBegin(), Id);
-        DB << Var.first->getNameAsString();
-        DB << std::get<0>(L).getAsString();
+    for (auto const &L : Usages) {
+        auto const DB = DE.Report(L.Location.getBegin(), Id);
+        DB << V->getNameAsString();
+        DB << L.Type.getAsString();
         DB.setForceEmit();
     }
 }
@@ -149,9 +149,9 @@ public:
 
     bool VisitFunctionDecl(clang::FunctionDecl const * const F) {
         if (F->isThisDeclarationADefinition()) {
-            ScopeAnalysis const &Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-            Analysis.ForEachReferenced([&](auto const Entry) {
-                EmitNoteMessage(Diagnostics, "symbol '%0' was used with type '%1'", Entry);
+            DebugScopeAnalysis const &Analysis = DebugScopeAnalysis::AnalyseThis(*(F->getBody()));
+            Analysis.ForEachReferenced([&](auto const Variable, auto const &Usages) {
+                EmitNoteMessage(Diagnostics, "symbol '%0' was used with type '%1'", Variable, Usages);
             });
         }
         return true;
@@ -172,9 +172,9 @@ public:
 
     bool VisitFunctionDecl(clang::FunctionDecl const * const F) {
         if (F->isThisDeclarationADefinition()) {
-            ScopeAnalysis const &Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-            Analysis.ForEachChanged([&](auto const Entry) {
-                EmitNoteMessage(Diagnostics, "variable '%0' with type '%1' was changed", Entry);
+            DebugScopeAnalysis const &Analysis = DebugScopeAnalysis::AnalyseThis(*(F->getBody()));
+            Analysis.ForEachChanged([&](auto const Variable, auto const &Usages) {
+                EmitNoteMessage(Diagnostics, "variable '%0' with type '%1' was changed", Variable, Usages);
             });
         }
         return true;
@@ -25,6 +25,7 @@ void function_call_test() {
     inc_const_ref(i);
     inc_p(&i); // expected-note {{variable 'i' with type 'int' was changed}}
     inc_const_p(&i);
+    inc_ref(++i); // expected-note 2 {{variable 'i' with type 'int' was changed}}
 
     int & iref = i;
 
@@ -60,3 +60,20 @@ void defined_type_usage_via_function_call() {
     Fixture f;
     const int k = Fixture::convert(f); // expected-note {{symbol 'f' was used}} // expected-note {{symbol 'convert' was used}} 
 }
+
+struct NestedFixture {
+    struct Inner {
+        int b;
+        int x;
+    };
+    Inner a;
+    Inner & get(int) {
+        return a; // expected-note {{symbol 'a' was used}}
+    }
+    int nested_member() {
+        return this->a.b; // expected-note 2 {{symbol 'a' was used}} // expected-note {{symbol 'b' was used}}
+    }
+    int member_of_call(int const k) {
+        return this->get(k).x; // expected-note 2 {{symbol 'k' was used}} // expected-note 2 {{symbol 'get' was used}} // expected-note {{symbol 'x' was used}}
+    }
+};
@@ -0,0 +1,17 @@
+// REQUIRES: constantine-run
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo '[{"directory": "%S/Inputs", "file": "ConstantineRunZeta.cc", "command": "%clang -fsyntax-only ConstantineRunZeta.cc"}, {"directory": "%S/Inputs", "file": "ConstantineRunBroken.cc", "command": "%clang -fsyntax-only ConstantineRunBroken.cc"}, {"directory": "%S/Inputs", "file": "ConstantineRunAlpha.cc", "command": "%clang -fsyntax-only ConstantineRunAlpha.cc"}]' > %t/compile_commands.json
+// RUN: %constantine_run -p %t -j 2 -filter 'Zeta|Alpha' > %t/filtered.txt
+// RUN: grep -c "could be declared as const" %t/filtered.txt | grep -qx 2
+// RUN: grep "could be declared as const" %t/filtered.txt | head -1 | grep -q "ConstantineRunZeta.cc:.*'zeta'"
+// RUN: grep "could be declared as const" %t/filtered.txt | tail -1 | grep -q "ConstantineRunAlpha.cc:.*'alpha'"
+// RUN: %constantine_run -p %t -j 2 > %t/all.txt 2> %t/all.err || touch %t/failed
+// RUN: test -f %t/failed
+// RUN: grep -c "could be declared as const" %t/all.txt | grep -qx 2
+// RUN: grep -q "constantine-run: failed to analyse .*ConstantineRunBroken.cc" %t/all.err
+// RUN: grep -c "failed to analyse" %t/all.err | grep -qx 1
+
+// The translation units are analysed in parallel, but the findings are
+// merged in the order of the compilation database: the 'Zeta' unit comes
+// first, the 'Alpha' unit last. The unit which does not compile makes the
+// exit code non-zero, but the findings of the others are still reported.
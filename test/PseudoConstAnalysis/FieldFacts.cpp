@@ -0,0 +1,28 @@
+// REQUIRES: constantine-fields
+// RUN: rm -rf %t && mkdir -p %t/one %t/two
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -field-facts -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t/one %s
+// RUN: %verify_const -DOTHER_UNIT -Xclang -plugin-arg-constantine -Xclang -field-facts -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t/two %s
+// RUN: %constantine_fields -database=%t/fields.db -o %t/report.txt %t/one %t/two
+// RUN: grep -q "FieldFacts.cpp:16:5: warning: variable 'count' could be declared as const" %t/report.txt
+// RUN: grep "variable 'total'" %t/report.txt > %t/unexpected.txt || true
+// RUN: test ! -s %t/unexpected.txt
+// RUN: %constantine_fields -database=%t/fields.db -o %t/report.txt %t/one %t/two 2>&1 | grep -q "0 fact files read, 2 unchanged"
+// RUN: %constantine_fields -database=%t/fields.db -o %t/report.txt %t/one 2>&1 | grep -q "1 removed"
+// RUN: grep -q "variable 'total' could be declared as const" %t/report.txt
+
+// expected-no-diagnostics
+// The member variables are not reported by the translation units, but by
+// the merge of their facts. The other unit changes 'total'.
+struct Meter {
+    int count;
+    int total;
+
+    int get() const { return count + total; }
+    void reset();
+};
+
+#ifdef OTHER_UNIT
+void Meter::reset() {
+    total = 0;
+}
+#endif
@@ -0,0 +1,35 @@
+// RUN: rm -rf %t && mkdir -p %t/jsonl %t/sarif
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -findings-format=jsonl -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t/jsonl %s
+// RUN: grep -q '"kind":"variable","name":"limit","usr":"c:[^"]*@limit","function":"count"' %t/jsonl/FindingsOutput.cpp-*.jsonl
+// RUN: grep -q '"kind":"function-const","name":"get","usr":"c:@S@Counter@F@get#","function":"Counter::get"' %t/jsonl/FindingsOutput.cpp-*.jsonl
+// RUN: grep -q '"kind":"function-static","name":"twice"' %t/jsonl/FindingsOutput.cpp-*.jsonl
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -findings-format=sarif -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t/sarif %s
+// RUN: grep -q '"version":"2.1.0"' %t/sarif/FindingsOutput.cpp-*.sarif
+// RUN: grep -q '"ruleId":"function-static"' %t/sarif/FindingsOutput.cpp-*.sarif
+
+// expected-no-diagnostics
+// The findings are written into the output file, not reported as warnings.
+int count(int const size) {
+    int result = 0;
+    int limit = size;
+    for (int i = 0; i < limit; ++i) {
+        ++result;
+    }
+    return result;
+}
+
+class Counter {
+public:
+    Counter() : value(0) {}
+
+    int get() {
+        return value;
+    }
+
+    int twice(int const x) {
+        return x * 2;
+    }
+
+private:
+    int value;
+};
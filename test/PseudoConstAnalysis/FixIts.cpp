@@ -0,0 +1,45 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -findings-format=replacements -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t %s
+// RUN: grep -q "MainSourceFile:  '.*FixIts.cpp'" %t/FixIts.cpp-*.yaml
+// RUN: grep -c "ReplacementText: 'const '" %t/FixIts.cpp-*.yaml | grep -qx 3
+// RUN: grep -c "ReplacementText: ' const'" %t/FixIts.cpp-*.yaml | grep -qx 2
+// RUN: grep -c "ReplacementText: ' const '" %t/FixIts.cpp-*.yaml | grep -qx 1
+// RUN: grep -q "ReplacementText: 'static '" %t/FixIts.cpp-*.yaml
+
+// expected-no-diagnostics
+// The fix-its are written as replacements: const before the type of the
+// variable (both declarations of the reference parameter), const after
+// the parameters of the method (both declarations), const after the star
+// of the pointer, and static before the method declaration.
+int sum(int & value, int const step);
+
+int sum(int & value, int const step) {
+    int result = value + step;
+    return result;
+}
+
+// The variables which share the type are not edited.
+int pair(int const seed) {
+    int a = seed, b = seed;
+    return a + b;
+}
+
+// The pointer itself is const, the pointed object is changed.
+int peek(int const seed) {
+    int value = seed;
+    int *cursor = &value;
+    ++value;
+    return *cursor;
+}
+
+struct Counter {
+    int get();
+    int twice(int const x) { return x * 2; }
+    void reset() { value = 0; }
+
+    int value;
+};
+
+int Counter::get() {
+    return value;
+}
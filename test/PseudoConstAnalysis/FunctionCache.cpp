@@ -0,0 +1,29 @@
+// RUN: rm -rf %t
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %s
+
+// The second run replays the function results from the cache.
+int sum(int const * const values, int const size) {
+    int result = 0;
+    int const limit = size;
+    int step = 1; // expected-warning {{variable 'step' could be declared as const}}
+    for (int i = 0; i < limit; i += step) {
+        result += values[i];
+    }
+    return result;
+}
+
+struct Counter {
+    int value;
+    int limit; // expected-warning {{variable 'limit' could be declared as const}}
+
+    void increment() {
+        ++value;
+    }
+    bool done() { // expected-warning {{function 'done' could be declared as const}}
+        return value == limit;
+    }
+    int twice(int const x) { // expected-warning {{function 'twice' could be declared as static}}
+        return x * 2;
+    }
+};
@@ -0,0 +1,30 @@
+// RUN: %verify_const %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -streaming %s
+
+#include <vector>
+
+// The functions of the included file change the member variables through
+// references: a free function which takes the class, a friend of it, one
+// through a global, one through a container, one through a pointer to
+// pointer, and a method of a helper class.
+struct Counter {
+    int value;
+    int step;
+    int mark;
+    int total;
+    int depth;
+    int turns;
+    int limit; // expected-warning {{variable 'limit' could be declared as const}}
+
+    bool done() const;
+
+    friend void rewind();
+};
+
+Counter shared;
+
+#include "Inputs/FunctionsDefinedInOtherFile.inc"
+
+bool Counter::done() const {
+    return value + step + mark + total + depth + turns == limit;
+}
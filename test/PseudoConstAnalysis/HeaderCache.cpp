@@ -0,0 +1,12 @@
+// RUN: rm -rf %t
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %s
+
+// The second run reports the header findings from the cache.
+#include "Inputs/HeaderCache.h"
+
+int use(Accumulator & a) {
+    a.add(1);
+    a.total = 0;
+    return a.get();
+}
@@ -0,0 +1,10 @@
+// RUN: rm -rf %t
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %S/Inputs/HeaderCacheContext.cc
+
+// The findings of the header depend on a macro, which is defined before
+// the include. The other translation unit defines it differently, so it
+// does not reuse the cached findings of this one.
+#define UPDATE(v) value = v
+#include "Inputs/HeaderCacheContext.h"
+// expected-warning@Inputs/HeaderCacheContext.h:3 {{variable 'other' could be declared as const}}
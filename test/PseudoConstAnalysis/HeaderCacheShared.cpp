@@ -0,0 +1,16 @@
+// RUN: rm -rf %t
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %s
+// RUN: ls %t | grep -c '\.findings$' | grep -qx 1
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -cache-dir=%t %S/Inputs/HeaderCacheShared.cc
+// RUN: ls %t | grep -c '\.findings$' | grep -qx 1
+
+// The other translation unit has different declarations and macros before
+// the header, but the same definition of the macro the header refers to.
+// So it reuses the cache entry of this one, instead of writing a new one.
+#define STEP 2
+#include "Inputs/HeaderCacheShared.h"
+
+int advance(Meter & meter) {
+    meter.tick();
+    return meter.read();
+}
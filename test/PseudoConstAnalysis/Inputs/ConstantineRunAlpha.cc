@@ -0,0 +1,6 @@
+// The last translation unit of ConstantineRun.cpp in the compilation
+// database, which shall be reported last regardless of the file name.
+int alpha_scale(int const value) {
+    int alpha = value * 3;
+    return alpha;
+}
@@ -0,0 +1,4 @@
+// The translation unit of ConstantineRun.cpp, which does not compile.
+int broken_scale(int const value {
+    return value;
+}
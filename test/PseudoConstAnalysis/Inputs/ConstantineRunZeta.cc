@@ -0,0 +1,6 @@
+// The first translation unit of ConstantineRun.cpp in the compilation
+// database, which shall be reported first regardless of the file name.
+int zeta_scale(int const value) {
+    int zeta = value * 2;
+    return zeta;
+}
@@ -0,0 +1,13 @@
+struct Accumulator {
+    int total;
+    int scale; // expected-warning {{variable 'scale' could be declared as const}}
+
+    void add(int value) { // expected-warning {{variable 'value' could be declared as const}}
+        int doubled = value * 2; // expected-warning {{variable 'doubled' could be declared as const}}
+        total += doubled;
+    }
+
+    int get() { // expected-warning {{function 'get' could be declared as const}}
+        return total * scale;
+    }
+};
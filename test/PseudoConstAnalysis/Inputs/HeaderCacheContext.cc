@@ -0,0 +1,7 @@
+// The other translation unit of HeaderCacheContext.cpp, which includes
+// the header after a different macro definition.
+#define UPDATE(v) (void)(value + v)
+#include "HeaderCacheContext.h"
+// expected-warning@HeaderCacheContext.h:2 {{variable 'value' could be declared as const}}
+// expected-warning@HeaderCacheContext.h:3 {{variable 'other' could be declared as const}}
+// expected-warning@HeaderCacheContext.h:5 {{function 'update' could be declared as const}}
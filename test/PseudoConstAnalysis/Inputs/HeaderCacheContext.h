@@ -0,0 +1,6 @@
+struct Context {
+    int value;
+    int other;
+
+    void update(int const v) { UPDATE(v); }
+};
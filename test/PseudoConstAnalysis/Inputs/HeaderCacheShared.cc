@@ -0,0 +1,11 @@
+// The other translation unit of HeaderCacheShared.cpp, which includes the
+// header in a different context.
+#define VERBOSE 1
+int calls = 0;
+
+#define STEP 2
+#include "HeaderCacheShared.h"
+
+void reset(Meter & meter) {
+    meter.count = VERBOSE ? 0 : calls;
+}
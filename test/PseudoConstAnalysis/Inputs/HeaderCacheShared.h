@@ -0,0 +1,10 @@
+struct Meter {
+    int count;
+    int limit; // expected-warning {{variable 'limit' could be declared as const}}
+
+    void tick() { count += STEP; }
+
+    int read() { // expected-warning {{function 'read' could be declared as const}}
+        return count < limit ? count : limit;
+    }
+};
@@ -0,0 +1,7 @@
+struct Gauge {
+    int count;
+    int total;
+
+    int get() const { return count + total; }
+    void reset();
+};
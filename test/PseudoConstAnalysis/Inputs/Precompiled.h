@@ -0,0 +1,10 @@
+struct Precompiled {
+    int value;
+
+    int get() const { return value; }
+    void set(int v) { value = v; }
+};
+
+inline int twice(Precompiled & p) {
+    return p.get() * 2;
+}
@@ -0,0 +1,55 @@
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-instantiations %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-instantiations -Xclang -plugin-arg-constantine -Xclang -streaming %s
+
+// The templates are analysed through their instantiations, the findings
+// are reported on the pattern.
+struct Counter {
+    void inc() { ++n; }
+    int get() const { return n; }
+
+    int n;
+};
+
+// The parameter is changed by the instantiation only.
+template <typename T>
+int touch(T & t) {
+    t.inc();
+    return t.get();
+}
+
+template <typename T>
+int read(T & t) { // expected-warning {{variable 't' could be declared as const}}
+    int result = t.get(); // expected-warning {{variable 'result' could be declared as const}}
+    return result;
+}
+
+// The instantiations of the method do not depend on the template
+// argument, those are analysed once.
+template <typename Tag>
+class Strong {
+public:
+    Strong() : value(0) {}
+
+    int get() { // expected-warning {{function 'get' could be declared as const}}
+        return value;
+    }
+
+    void set(int const v) {
+        value = v;
+    }
+
+private:
+    int value;
+};
+
+struct A {};
+struct B {};
+
+int use() {
+    Counter c = { 0 };
+    Strong<A> a;
+    Strong<B> b;
+    a.set(1);
+    b.set(2);
+    return touch(c) + read(c) + a.get() + b.get();
+}
@@ -0,0 +1,17 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -memory-report=json -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t %s
+// RUN: grep -q '"declaration-collector":{"allocations":[1-9][0-9]*,"allocated_bytes":[1-9][0-9]*}' %t/MemoryReport.cpp-*.memory.json
+// RUN: grep -q '"scope-analysis":{"allocations":[1-9][0-9]*,"allocated_bytes":[1-9][0-9]*}' %t/MemoryReport.cpp-*.memory.json
+// RUN: grep -q '"state":{"allocations":[1-9][0-9]*,"allocated_bytes":[1-9][0-9]*}' %t/MemoryReport.cpp-*.memory.json
+// RUN: grep -q '"peak_live_bytes":[1-9]' %t/MemoryReport.cpp-*.memory.json
+
+// The allocations of the analysis are reported (every phase allocates
+// for this function), the findings are not changed by it.
+int sum(int const count) {
+    int total = 0;
+    int step = 1; // expected-warning {{variable 'step' could be declared as const}}
+    for (int i = 0; i < count; ++i) {
+        total += step;
+    }
+    return total;
+}
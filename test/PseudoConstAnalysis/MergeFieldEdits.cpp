@@ -0,0 +1,25 @@
+// REQUIRES: constantine-fields, constantine-merge
+// RUN: rm -rf %t && mkdir -p %t/one %t/two %t/merged
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -field-facts -Xclang -plugin-arg-constantine -Xclang -findings-format=replacements -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t/one %s
+// RUN: %verify_const -DOTHER_UNIT -Xclang -plugin-arg-constantine -Xclang -analyze-headers -Xclang -plugin-arg-constantine -Xclang -field-facts -Xclang -plugin-arg-constantine -Xclang -findings-format=replacements -Xclang -plugin-arg-constantine -Xclang -findings-dir=%t/two %s
+// RUN: grep -q "# Field: *'c:@S@Gauge@FI@total'" %t/one/*.yaml
+// RUN: %constantine_merge -o %t/merged/unverified.yaml %t/one %t/two
+// RUN: grep "ReplacementText" %t/merged/unverified.yaml > %t/unexpected.txt || true
+// RUN: test ! -s %t/unexpected.txt
+// RUN: %constantine_fields -database=%t/fields.db -o %t/report.txt %t/one %t/two
+// RUN: %constantine_merge -fields=%t/fields.db -o %t/merged/verified.yaml %t/one %t/two
+// RUN: grep -c "ReplacementText: 'const '" %t/merged/verified.yaml | grep -qx 1
+// RUN: grep -q "# Field: *'c:@S@Gauge@FI@count'" %t/merged/verified.yaml
+
+// expected-no-diagnostics
+// The member variables of the header are edited by the first unit, but
+// the other unit changes 'total'. Without the field verdict the header
+// edits of the member variables are dropped, with it only 'count' is
+// edited.
+#include "Inputs/MergeFieldEdits.h"
+
+#ifdef OTHER_UNIT
+void Gauge::reset() {
+    total = 0;
+}
+#endif
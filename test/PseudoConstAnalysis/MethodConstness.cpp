@@ -1,4 +1,6 @@
 // RUN: %verify_const %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -analysis-jobs=4 %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -streaming %s
 
 struct BaseOne {
     int value;
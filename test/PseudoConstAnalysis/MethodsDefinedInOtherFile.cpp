@@ -0,0 +1,16 @@
+// RUN: %verify_const %s
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -streaming %s
+
+struct Counter {
+    int value;
+    int limit; // expected-warning {{variable 'limit' could be declared as const}}
+
+    void increment();
+    bool done() const;
+};
+
+#include "Inputs/MethodsDefinedInOtherFile.inc"
+
+bool Counter::done() const {
+    return value == limit;
+}
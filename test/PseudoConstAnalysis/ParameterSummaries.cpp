@@ -0,0 +1,21 @@
+// RUN: %verify_const -Xclang -plugin-arg-constantine -Xclang -parameter-summaries %s
+
+// The calls are evaluated by what the callee does with its parameters.
+void bump(int & x) {
+    ++x;
+}
+
+int peek(int & x) { // expected-warning {{variable 'x' could be declared as const}}
+    return x;
+}
+
+int forward(int & x) { // expected-warning {{variable 'x' could be declared as const}}
+    return peek(x);
+}
+
+int caller() {
+    int a = 1; // expected-warning {{variable 'a' could be declared as const}}
+    int b = 2;
+    bump(b);
+    return forward(a) + b;
+}
@@ -0,0 +1,14 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %clang -x c++-header %S/Inputs/Precompiled.h -o %t/Precompiled.h.pch
+// RUN: %verify_const -include-pch %t/Precompiled.h.pch %s
+
+// The declarations of the precompiled header are loaded only when those
+// are referenced from the main file.
+int read(Precompiled & p) { // expected-warning {{variable 'p' could be declared as const}}
+    return p.get();
+}
+
+int write(Precompiled & p) {
+    p.set(1);
+    return twice(p);
+}
@@ -8,3 +8,27 @@ void test() {
 
     ++(*j);
 }
+
+void test_shared_referee(bool const c) {
+    int i = 0;
+    int j = 0;
+    int & k = i;
+    int * l = c ? &k : &j;
+    int * m = l;
+    int & n = *l;
+
+    ++(*m);
+    ++n;
+}
+
+struct Chain {
+    int Member;
+
+    void test_member() {
+        int & k = Member;
+        int * l = &k;
+        int * m = l;
+
+        ++(*m);
+    }
+};